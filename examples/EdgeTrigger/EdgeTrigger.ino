@@ -0,0 +1,111 @@
+#include <Streaming.h>
+#include <Functor.h>
+#include <EventController.h>
+
+
+const long BAUD = 115200;
+const size_t TIMER_NUMBER = 1;
+const int INPUT_PIN = 2;
+const int LED_PIN = 13;
+const uint8_t TRIGGER_GROUP = 0;
+const uint32_t RESPONSE_DELAY = 10;
+const uint32_t PULSE_PERIOD = 20;
+const uint32_t PULSE_ON_DURATION = 10;
+const int32_t PULSE_COUNT = 3;
+const uint32_t RESPONSE_DURATION = RESPONSE_DELAY + PULSE_PERIOD*PULSE_COUNT;
+
+// inject synthetic edges instead of waiting on INPUT_PIN
+const bool INJECT_EDGES = true;
+const uint32_t INJECT_PERIOD = 1000;
+const uint32_t INJECT_LATENCY_US = 3000;
+
+const int EVENT_COUNT_MAX = 8;
+EventController<EVENT_COUNT_MAX> event_controller;
+
+EventIdPair response_event_id_pair;
+volatile uint32_t edge_time = 0;
+volatile uint32_t response_time = 0;
+volatile bool responding = false;
+
+
+void ledOnEventHandler(int arg)
+{
+  if (response_time == 0)
+  {
+    response_time = event_controller.getTime();
+  }
+  digitalWrite(LED_PIN,HIGH);
+}
+
+void ledOffEventHandler(int arg)
+{
+  digitalWrite(LED_PIN,LOW);
+}
+
+void armResponse()
+{
+  response_event_id_pair = event_controller.addPwmUsingDelay(makeFunctor((Functor1<int> *)0,ledOnEventHandler),
+    makeFunctor((Functor1<int> *)0,ledOffEventHandler),
+    RESPONSE_DELAY,
+    PULSE_PERIOD,
+    PULSE_ON_DURATION,
+    PULSE_COUNT);
+  event_controller.arm(response_event_id_pair,TRIGGER_GROUP);
+}
+
+void edgeHandler(uint32_t capture_time_us)
+{
+  if (responding)
+  {
+    return;
+  }
+  responding = true;
+  edge_time = event_controller.getTime() - (micros() - capture_time_us)/EventController<EVENT_COUNT_MAX>::MICRO_SEC_PER_MILLI_SEC;
+  event_controller.triggerUsingCaptureTime(TRIGGER_GROUP,capture_time_us);
+}
+
+void inputPinInterruptHandler()
+{
+  edgeHandler(micros());
+}
+
+void injectEdgeEventHandler(int arg)
+{
+  edgeHandler(micros() - INJECT_LATENCY_US);
+}
+
+void setup()
+{
+  Serial.begin(BAUD);
+
+  pinMode(LED_PIN,OUTPUT);
+  digitalWrite(LED_PIN,LOW);
+
+  event_controller.setup(TIMER_NUMBER);
+  armResponse();
+
+  if (INJECT_EDGES)
+  {
+    EventId inject_event_id = event_controller.addInfiniteRecurringEventUsingDelay(makeFunctor((Functor1<int> *)0,injectEdgeEventHandler),
+      INJECT_PERIOD,
+      INJECT_PERIOD);
+    event_controller.enable(inject_event_id);
+  }
+  else
+  {
+    pinMode(INPUT_PIN,INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(INPUT_PIN),inputPinInterruptHandler,FALLING);
+  }
+}
+
+
+void loop()
+{
+  if (responding && (event_controller.getTime() > (edge_time + RESPONSE_DURATION)))
+  {
+    Serial << "edge_time = " << edge_time << ", response_time = " << response_time << ", latency = " << (response_time - edge_time) << "\n";
+    response_time = 0;
+    armResponse();
+    responding = false;
+  }
+}
@@ -0,0 +1,194 @@
+#include <Streaming.h>
+#include <Functor.h>
+#include <EventController.h>
+
+
+const long BAUD = 115200;
+const size_t TIMER_NUMBER = 1;
+const uint32_t SPIN_DURATION_US = 1000000;
+const uint16_t OPERATION_REPEAT_COUNT = 200;
+const uint32_t NANO_SEC_PER_MICRO_SEC = 1000;
+const uint32_t NANO_SEC_PER_TICK = 1000000;
+const uint32_t EVENT_DELAY = 1;
+const uint32_t EVENT_PERIOD = 1;
+const uint32_t PWM_PERIOD = 4;
+const uint32_t PWM_ON_DURATION = 2;
+const uint32_t CHURN_DELAY = 1000;
+
+EventController<8> event_controller_8;
+EventController<16> event_controller_16;
+EventController<32> event_controller_32;
+
+volatile uint32_t handler_count = 0;
+uint32_t spin_count_baseline = 0;
+
+
+void benchmarkEventHandler(int arg)
+{
+  ++handler_count;
+}
+
+uint32_t countSpins()
+{
+  volatile uint32_t spin_count = 0;
+  uint32_t time_start = micros();
+  while ((micros() - time_start) < SPIN_DURATION_US)
+  {
+    ++spin_count;
+  }
+  return spin_count;
+}
+
+uint32_t getTickCost(uint32_t spin_count)
+{
+  if ((spin_count_baseline == 0) || (spin_count >= spin_count_baseline))
+  {
+    return 0;
+  }
+  uint64_t spin_count_lost = spin_count_baseline - spin_count;
+  return (spin_count_lost * NANO_SEC_PER_TICK) / spin_count_baseline;
+}
+
+void printResult(const char * workload,
+  uint8_t event_count_max,
+  const char * measure,
+  uint32_t ns)
+{
+  Serial << workload << ", " << event_count_max << ", " << measure << ", " << ns << "\n";
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void benchmarkTicks(EventController<EVENT_COUNT_MAX> & event_controller)
+{
+  Functor1<int> functor = makeFunctor((Functor1<int> *)0,benchmarkEventHandler);
+
+  event_controller.removeAllEvents();
+  printResult("idle",EVENT_COUNT_MAX,"ns/tick",getTickCost(countSpins()));
+
+  for (uint8_t i=0; i<EVENT_COUNT_MAX; ++i)
+  {
+    EventId event_id = event_controller.addInfiniteRecurringEventUsingDelay(functor,
+      EVENT_DELAY,
+      EVENT_PERIOD);
+    event_controller.enable(event_id);
+  }
+  printResult("dense",EVENT_COUNT_MAX,"ns/tick",getTickCost(countSpins()));
+
+  event_controller.removeAllEvents();
+  for (uint8_t i=0; i<EVENT_COUNT_MAX/2; ++i)
+  {
+    EventIdPair event_id_pair = event_controller.addInfinitePwmUsingDelay(functor,
+      functor,
+      EVENT_DELAY,
+      PWM_PERIOD,
+      PWM_ON_DURATION);
+    event_controller.enable(event_id_pair);
+  }
+  printResult("pwm",EVENT_COUNT_MAX,"ns/tick",getTickCost(countSpins()));
+
+  event_controller.removeAllEvents();
+  for (uint8_t i=0; i<EVENT_COUNT_MAX; ++i)
+  {
+    EventId event_id;
+    if (i % 2)
+    {
+      event_id = event_controller.addEventUsingDelay(functor,
+        CHURN_DELAY);
+    }
+    else
+    {
+      event_id = event_controller.addInfiniteRecurringEventUsingDelay(functor,
+        EVENT_DELAY,
+        EVENT_PERIOD*(i + 1));
+    }
+    event_controller.enable(event_id);
+  }
+  printResult("mixed",EVENT_COUNT_MAX,"ns/tick",getTickCost(countSpins()));
+  event_controller.removeAllEvents();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void benchmarkOperations(EventController<EVENT_COUNT_MAX> & event_controller)
+{
+  Functor1<int> functor = makeFunctor((Functor1<int> *)0,benchmarkEventHandler);
+  EventId event_ids[EVENT_COUNT_MAX];
+  uint32_t time_add = 0;
+  uint32_t time_remove = 0;
+  uint32_t time_available = 0;
+  uint32_t operation_count = 0;
+
+  event_controller.removeAllEvents();
+  for (uint16_t repeat=0; repeat<OPERATION_REPEAT_COUNT; ++repeat)
+  {
+    uint32_t time_start = micros();
+    for (uint8_t i=0; i<EVENT_COUNT_MAX; ++i)
+    {
+      event_ids[i] = event_controller.addEventUsingDelay(functor,
+        CHURN_DELAY);
+    }
+    time_add += micros() - time_start;
+
+    time_start = micros();
+    event_controller.eventsAvailable();
+    time_available += micros() - time_start;
+
+    time_start = micros();
+    for (uint8_t i=0; i<EVENT_COUNT_MAX; ++i)
+    {
+      event_controller.remove(event_ids[i]);
+    }
+    time_remove += micros() - time_start;
+    operation_count += EVENT_COUNT_MAX;
+  }
+  printResult("churn",EVENT_COUNT_MAX,"ns/add",(uint64_t)time_add*NANO_SEC_PER_MICRO_SEC/operation_count);
+  printResult("churn",EVENT_COUNT_MAX,"ns/remove",(uint64_t)time_remove*NANO_SEC_PER_MICRO_SEC/operation_count);
+  printResult("churn",EVENT_COUNT_MAX,"ns/eventsAvailable",(uint64_t)time_available*NANO_SEC_PER_MICRO_SEC/OPERATION_REPEAT_COUNT);
+
+  uint32_t time_pwm = 0;
+  operation_count = 0;
+  for (uint16_t repeat=0; repeat<OPERATION_REPEAT_COUNT; ++repeat)
+  {
+    uint32_t time_start = micros();
+    EventIdPair event_id_pair = event_controller.addPwmUsingDelay(functor,
+      functor,
+      CHURN_DELAY,
+      PWM_PERIOD,
+      PWM_ON_DURATION,
+      1);
+    time_pwm += micros() - time_start;
+    event_controller.remove(event_id_pair);
+    ++operation_count;
+  }
+  printResult("churn",EVENT_COUNT_MAX,"ns/addPwm",(uint64_t)time_pwm*NANO_SEC_PER_MICRO_SEC/operation_count);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void benchmark(EventController<EVENT_COUNT_MAX> & event_controller)
+{
+  event_controller.setup(TIMER_NUMBER);
+  benchmarkTicks(event_controller);
+  benchmarkOperations(event_controller);
+}
+
+void setup()
+{
+  Serial.begin(BAUD);
+  delay(1000);
+
+  Serial << "workload, event_count_max, measure, ns\n";
+
+  Timer1.stop();
+  spin_count_baseline = countSpins();
+
+  benchmark(event_controller_8);
+  benchmark(event_controller_16);
+  benchmark(event_controller_32);
+
+  Timer1.stop();
+  Serial << "done\n";
+}
+
+
+void loop()
+{
+}
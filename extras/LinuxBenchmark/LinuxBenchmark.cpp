@@ -0,0 +1,202 @@
+// ----------------------------------------------------------------------------
+// LinuxBenchmark.cpp
+//
+// Host version of the EventControllerBenchmark example. Ticks are driven from
+// main through EventTimerManual, so each workload reports the time spent in
+// update rather than the spin loss measured on a board. See ../README.org for
+// build instructions.
+//
+// Authors:
+// Peter Polidoro peterpolidoro@gmail.com
+// ----------------------------------------------------------------------------
+#include <stdio.h>
+#include <time.h>
+#include <EventController.h>
+#include <EventController/EventTimerManual.h>
+
+
+const uint32_t TICK_COUNT = 100000;
+const uint16_t OPERATION_REPEAT_COUNT = 2000;
+const uint64_t NANO_SEC_PER_SEC = 1000000000;
+const uint32_t EVENT_DELAY = 1;
+const uint32_t EVENT_PERIOD = 1;
+const uint32_t PWM_PERIOD = 4;
+const uint32_t PWM_ON_DURATION = 2;
+const uint32_t CHURN_DELAY = 1000;
+const uint8_t PWM_CHANNEL_COUNT_MAX = 32;
+
+EventController<8> event_controller_8;
+EventController<16> event_controller_16;
+EventController<32> event_controller_32;
+EventTimerManual event_timer;
+PwmChannel pwm_channels[PWM_CHANNEL_COUNT_MAX];
+
+volatile uint32_t handler_count = 0;
+
+
+void benchmarkEventHandler(int arg)
+{
+  ++handler_count;
+}
+
+uint64_t getTimeNs()
+{
+  timespec time;
+  clock_gettime(CLOCK_MONOTONIC,&time);
+  return (uint64_t)time.tv_sec*NANO_SEC_PER_SEC + time.tv_nsec;
+}
+
+uint64_t getTickCost()
+{
+  uint64_t time_start = getTimeNs();
+  event_timer.tick(TICK_COUNT);
+  return (getTimeNs() - time_start) / TICK_COUNT;
+}
+
+void printResult(const char * workload,
+  uint8_t event_count_max,
+  const char * measure,
+  uint64_t ns)
+{
+  printf("%s, %u, %s, %llu\n",workload,event_count_max,measure,(unsigned long long)ns);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void benchmarkTicks(EventController<EVENT_COUNT_MAX> & event_controller)
+{
+  Functor1<int> functor = makeFunctor((Functor1<int> *)0,benchmarkEventHandler);
+
+  event_controller.removeAllEvents();
+  printResult("idle",EVENT_COUNT_MAX,"ns/tick",getTickCost());
+
+  for (uint8_t i=0; i<EVENT_COUNT_MAX; ++i)
+  {
+    EventId event_id = event_controller.addInfiniteRecurringEventUsingDelay(functor,
+      EVENT_DELAY,
+      EVENT_PERIOD);
+    event_controller.enable(event_id);
+  }
+  printResult("dense",EVENT_COUNT_MAX,"ns/tick",getTickCost());
+
+  event_controller.removeAllEvents();
+  for (uint8_t i=0; i<EVENT_COUNT_MAX/2; ++i)
+  {
+    EventIdPair event_id_pair = event_controller.addInfinitePwmUsingDelay(functor,
+      functor,
+      EVENT_DELAY,
+      PWM_PERIOD,
+      PWM_ON_DURATION);
+    event_controller.enable(event_id_pair);
+  }
+  printResult("pwm",EVENT_COUNT_MAX,"ns/tick",getTickCost());
+
+  event_controller.removeAllEvents();
+  event_controller.setupPwmChannels(pwm_channels,EVENT_COUNT_MAX);
+  for (uint8_t i=0; i<EVENT_COUNT_MAX; ++i)
+  {
+    EventId pwm_channel_id = event_controller.addPwmChannelUsingDelay(functor,
+      functor,
+      EVENT_DELAY,
+      PWM_PERIOD,
+      PWM_ON_DURATION,
+      -1);
+    event_controller.enablePwmChannel(pwm_channel_id);
+  }
+  printResult("pwm_channels",EVENT_COUNT_MAX,"ns/tick",getTickCost());
+  event_controller.setupPwmChannels(NULL,0);
+
+  for (uint8_t i=0; i<EVENT_COUNT_MAX; ++i)
+  {
+    EventId event_id;
+    if (i % 2)
+    {
+      event_id = event_controller.addEventUsingDelay(functor,
+        CHURN_DELAY);
+    }
+    else
+    {
+      event_id = event_controller.addInfiniteRecurringEventUsingDelay(functor,
+        EVENT_DELAY,
+        EVENT_PERIOD*(i + 1));
+    }
+    event_controller.enable(event_id);
+  }
+  printResult("mixed",EVENT_COUNT_MAX,"ns/tick",getTickCost());
+  event_controller.removeAllEvents();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void benchmarkOperations(EventController<EVENT_COUNT_MAX> & event_controller)
+{
+  Functor1<int> functor = makeFunctor((Functor1<int> *)0,benchmarkEventHandler);
+  EventId event_ids[EVENT_COUNT_MAX];
+  uint64_t time_add = 0;
+  uint64_t time_remove = 0;
+  uint64_t time_available = 0;
+  uint32_t operation_count = 0;
+
+  event_controller.removeAllEvents();
+  for (uint16_t repeat=0; repeat<OPERATION_REPEAT_COUNT; ++repeat)
+  {
+    uint64_t time_start = getTimeNs();
+    for (uint8_t i=0; i<EVENT_COUNT_MAX; ++i)
+    {
+      event_ids[i] = event_controller.addEventUsingDelay(functor,
+        CHURN_DELAY);
+    }
+    time_add += getTimeNs() - time_start;
+
+    time_start = getTimeNs();
+    event_controller.eventsAvailable();
+    time_available += getTimeNs() - time_start;
+
+    time_start = getTimeNs();
+    for (uint8_t i=0; i<EVENT_COUNT_MAX; ++i)
+    {
+      event_controller.remove(event_ids[i]);
+    }
+    time_remove += getTimeNs() - time_start;
+    operation_count += EVENT_COUNT_MAX;
+    event_timer.tick();
+  }
+  printResult("churn",EVENT_COUNT_MAX,"ns/add",time_add/operation_count);
+  printResult("churn",EVENT_COUNT_MAX,"ns/remove",time_remove/operation_count);
+  printResult("churn",EVENT_COUNT_MAX,"ns/eventsAvailable",time_available/OPERATION_REPEAT_COUNT);
+
+  uint64_t time_pwm = 0;
+  operation_count = 0;
+  for (uint16_t repeat=0; repeat<OPERATION_REPEAT_COUNT; ++repeat)
+  {
+    uint64_t time_start = getTimeNs();
+    EventIdPair event_id_pair = event_controller.addPwmUsingDelay(functor,
+      functor,
+      CHURN_DELAY,
+      PWM_PERIOD,
+      PWM_ON_DURATION,
+      1);
+    time_pwm += getTimeNs() - time_start;
+    event_controller.remove(event_id_pair);
+    ++operation_count;
+  }
+  printResult("churn",EVENT_COUNT_MAX,"ns/addPwm",time_pwm/operation_count);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void benchmark(EventController<EVENT_COUNT_MAX> & event_controller)
+{
+  event_controller.setup(event_timer);
+  benchmarkTicks(event_controller);
+  benchmarkOperations(event_controller);
+}
+
+int main()
+{
+  printf("workload, event_count_max, measure, ns\n");
+
+  benchmark(event_controller_8);
+  benchmark(event_controller_16);
+  benchmark(event_controller_32);
+
+  printf("done\n");
+  return 0;
+}
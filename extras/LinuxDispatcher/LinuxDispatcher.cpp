@@ -0,0 +1,104 @@
+// ----------------------------------------------------------------------------
+// LinuxDispatcher.cpp
+//
+// Checks EventDispatcherThreads on a Linux host. Ticks are driven from main
+// through EventTimerManual, which holds the interrupt lock around each tick
+// like EventTimerLinux does. Checks that events with an affinity always run
+// on the same worker, that different affinities run on different workers,
+// and that every job posted in a tick has finished when the tick returns.
+// See ../README.org for build instructions.
+//
+// Authors:
+// Peter Polidoro peterpolidoro@gmail.com
+// ----------------------------------------------------------------------------
+#include <stdio.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <EventController.h>
+#include <EventController/EventTimerManual.h>
+#include <EventController/EventDispatcherThreads.h>
+
+
+const uint8_t WORKER_COUNT = 4;
+const uint32_t TICK_COUNT = 200;
+const uint32_t JOB_DURATION_US = 100;
+
+const int EVENT_COUNT_MAX = WORKER_COUNT;
+EventController<EVENT_COUNT_MAX> event_controller;
+EventTimerManual event_timer;
+
+std::atomic<uint32_t> job_count(0);
+std::atomic<uint32_t> affinity_error_count(0);
+std::thread::id worker_ids[WORKER_COUNT];
+std::atomic<bool> worker_id_set[WORKER_COUNT];
+
+
+void jobEventHandler(int arg)
+{
+  std::thread::id worker_id = std::this_thread::get_id();
+  if (!worker_id_set[arg])
+  {
+    worker_ids[arg] = worker_id;
+    worker_id_set[arg] = true;
+  }
+  else if (worker_ids[arg] != worker_id)
+  {
+    ++affinity_error_count;
+  }
+  usleep(JOB_DURATION_US);
+  ++job_count;
+}
+
+int main()
+{
+  EventDispatcherThreads event_dispatcher(WORKER_COUNT);
+  event_controller.setup(event_timer);
+  event_controller.setupDispatcher(&event_dispatcher);
+
+  for (uint8_t worker_index=0; worker_index<WORKER_COUNT; ++worker_index)
+  {
+    worker_id_set[worker_index] = false;
+    EventId event_id = event_controller.addInfiniteRecurringEventUsingDelay(makeFunctor((Functor1<int> *)0,jobEventHandler),
+      1,
+      1,
+      worker_index);
+    event_controller.setAffinity(event_id,worker_index);
+    event_controller.enable(event_id);
+  }
+
+  uint32_t barrier_error_count = 0;
+  for (uint32_t tick=1; tick<=TICK_COUNT; ++tick)
+  {
+    event_timer.tick();
+    if (job_count != tick*WORKER_COUNT)
+    {
+      ++barrier_error_count;
+    }
+  }
+
+  uint32_t shared_worker_count = 0;
+  for (uint8_t worker_index=0; worker_index<WORKER_COUNT; ++worker_index)
+  {
+    for (uint8_t other_index=worker_index+1; other_index<WORKER_COUNT; ++other_index)
+    {
+      if (worker_ids[worker_index] == worker_ids[other_index])
+      {
+        ++shared_worker_count;
+      }
+    }
+  }
+
+  printf("ticks = %u, jobs = %u\n",TICK_COUNT,(uint32_t)job_count);
+  printf("barrier errors = %u, affinity errors = %u, shared workers = %u\n",
+    barrier_error_count,
+    (uint32_t)affinity_error_count,
+    shared_worker_count);
+
+  bool passed = (job_count == TICK_COUNT*WORKER_COUNT) &&
+    (barrier_error_count == 0) &&
+    (affinity_error_count == 0) &&
+    (shared_worker_count == 0);
+  printf("%s\n",passed ? "PASS" : "FAIL");
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+// ----------------------------------------------------------------------------
+// LinuxEdgeTrigger.cpp
+//
+// Host check for triggerUsingCaptureTime. Ticks are driven from main through
+// EventTimerManual. Each edge is injected with a capture timestamp a known
+// latency in the past, and the armed response must run on the tick
+// RESPONSE_DELAY after the captured edge, or on the next tick when that tick
+// has already passed. See ../README.org for build instructions.
+//
+// Authors:
+// Peter Polidoro peterpolidoro@gmail.com
+// ----------------------------------------------------------------------------
+#include <stdio.h>
+#include <EventController.h>
+#include <EventController/EventTimerManual.h>
+
+
+const uint8_t TRIGGER_GROUP = 0;
+const uint32_t RESPONSE_DELAY = 10;
+const uint32_t EDGE_PERIOD = 50;
+// keep capture latencies half a millisecond away from a tick boundary
+const uint32_t LATENCY_OFFSET_US = 500;
+const uint32_t LATENCY_MS[] = {0,1,3,7,9,10,15,40};
+const size_t LATENCY_COUNT = sizeof(LATENCY_MS)/sizeof(LATENCY_MS[0]);
+
+const int EVENT_COUNT_MAX = 4;
+EventController<EVENT_COUNT_MAX> event_controller;
+EventTimerManual event_timer;
+
+volatile uint32_t response_time = 0;
+volatile uint32_t response_count = 0;
+
+
+void responseEventHandler(int arg)
+{
+  response_time = event_controller.getTime();
+  ++response_count;
+}
+
+int main()
+{
+  event_controller.setup(event_timer);
+
+  uint32_t error_count = 0;
+  for (size_t latency_index=0; latency_index<LATENCY_COUNT; ++latency_index)
+  {
+    uint32_t latency_ms = LATENCY_MS[latency_index];
+    EventId response_event_id = event_controller.addEventUsingDelay(makeFunctor((Functor1<int> *)0,responseEventHandler),
+      RESPONSE_DELAY);
+    event_controller.arm(response_event_id,TRIGGER_GROUP);
+    event_controller.enable(response_event_id);
+    event_timer.tick(EDGE_PERIOD);
+
+    uint32_t response_count_prev = response_count;
+    uint32_t edge_time = event_controller.getTime() - latency_ms;
+    uint32_t capture_time_us = micros() - (latency_ms*EventController<EVENT_COUNT_MAX>::MICRO_SEC_PER_MILLI_SEC + LATENCY_OFFSET_US);
+    event_controller.triggerUsingCaptureTime(TRIGGER_GROUP,capture_time_us);
+
+    uint32_t expected_time = edge_time + RESPONSE_DELAY;
+    if ((int32_t)(expected_time - event_controller.getTime()) <= 0)
+    {
+      expected_time = event_controller.getTime() + 1;
+    }
+    event_timer.tick(EDGE_PERIOD);
+
+    bool passed = (response_count == response_count_prev + 1) && (response_time == expected_time);
+    if (!passed)
+    {
+      ++error_count;
+    }
+    printf("latency = %u ms, edge_time = %u, expected_time = %u, response_time = %u, %s\n",
+      latency_ms,
+      edge_time,
+      expected_time,
+      (uint32_t)response_time,
+      passed ? "ok" : "error");
+  }
+
+  bool passed = (error_count == 0) && (event_controller.eventsActive() == 0);
+  printf("%s\n",passed ? "PASS" : "FAIL");
+  return passed ? 0 : 1;
+}
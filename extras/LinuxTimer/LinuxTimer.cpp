@@ -0,0 +1,84 @@
+// ----------------------------------------------------------------------------
+// LinuxTimer.cpp
+//
+// Runs an EventController on a Linux host using EventTimerLinux. See
+// ../README.org for build instructions.
+//
+// Authors:
+// Peter Polidoro peterpolidoro@gmail.com
+// ----------------------------------------------------------------------------
+#include <stdio.h>
+#include <unistd.h>
+#include <EventController.h>
+
+
+const uint32_t RUN_DURATION_S = 5;
+const uint32_t CLOCK_PERIOD = 10;
+const uint32_t LED_DELAY = 100;
+const uint32_t LED_PERIOD = 200;
+const uint32_t LED_ON_DURATION = 50;
+const int32_t LED_COUNT = 10;
+
+const int EVENT_COUNT_MAX = 8;
+EventController<EVENT_COUNT_MAX> event_controller;
+EventTimerLinux event_timer;
+
+volatile uint32_t clock_count = 0;
+volatile uint32_t led_on_count = 0;
+volatile uint32_t led_off_count = 0;
+
+
+void clockUpdateEventHandler(int arg)
+{
+  ++clock_count;
+}
+
+void ledOnEventHandler(int arg)
+{
+  ++led_on_count;
+}
+
+void ledOffEventHandler(int arg)
+{
+  ++led_off_count;
+}
+
+int main()
+{
+  event_controller.setup(event_timer);
+
+  EventId clock_event_id = event_controller.addInfiniteRecurringEventUsingDelay(makeFunctor((Functor1<int> *)0,clockUpdateEventHandler),
+    CLOCK_PERIOD,
+    CLOCK_PERIOD);
+  event_controller.enable(clock_event_id);
+
+  EventIdPair led_event_id_pair = event_controller.addPwmUsingDelay(makeFunctor((Functor1<int> *)0,ledOnEventHandler),
+    makeFunctor((Functor1<int> *)0,ledOffEventHandler),
+    LED_DELAY,
+    LED_PERIOD,
+    LED_ON_DURATION,
+    LED_COUNT);
+  event_controller.enable(led_event_id_pair);
+
+  sleep(RUN_DURATION_S);
+  event_timer.stop();
+
+  EventTimerJitter jitter = event_timer.getJitter();
+  uint32_t time = event_controller.getTime();
+  printf("realtime = %d\n",event_timer.realtime());
+  printf("time = %u ms, ticks = %u, overruns = %u\n",time,jitter.tick_count,jitter.overrun_count);
+  if (jitter.tick_count > 0)
+  {
+    printf("latency min = %lld ns, max = %lld ns, mean = %lld ns\n",
+      (long long)jitter.latency_min_ns,
+      (long long)jitter.latency_max_ns,
+      (long long)(jitter.latency_sum_ns / jitter.tick_count));
+  }
+  printf("clock_count = %u, led_on_count = %u, led_off_count = %u\n",clock_count,led_on_count,led_off_count);
+
+  bool passed = (clock_count == time/CLOCK_PERIOD) &&
+    (led_on_count == (uint32_t)LED_COUNT) &&
+    (led_off_count == (uint32_t)LED_COUNT);
+  printf("%s\n",passed ? "PASS" : "FAIL");
+  return passed ? 0 : 1;
+}
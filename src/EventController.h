@@ -7,28 +7,208 @@
 // ----------------------------------------------------------------------------
 #ifndef EVENT_CONTROLLER_H
 #define EVENT_CONTROLLER_H
+#if defined(ARDUINO)
 #include <Arduino.h>
-#include <Array.h>
 #include <TimerOne.h>
 #include <TimerThree.h>
+#else
+#include "EventController/EventTimerLinux.h"
+#endif
+#include <Array.h>
 #include <Functor.h>
 #include <FunctorCallbacks.h>
 
+#include "EventController/EventTimer.h"
+#include "EventController/EventDispatcher.h"
+
+
+#if defined(__AVR__)
+typedef uint8_t PortRegister;
+typedef uint8_t InterruptState;
+#else
+typedef uint32_t PortRegister;
+typedef uint32_t InterruptState;
+#endif
+
+enum PortActionType
+{
+  PORT_ACTION_NONE,
+  PORT_ACTION_SET,
+  PORT_ACTION_CLEAR,
+  PORT_ACTION_TOGGLE,
+};
+struct PortAction
+{
+  volatile PortRegister * port;
+  PortRegister mask;
+  uint8_t type;
+  PortAction() :
+  port(0),
+  mask(0),
+  type(PORT_ACTION_NONE) {}
+};
+struct PortInput
+{
+  volatile PortRegister * port;
+  PortRegister mask;
+  PortInput() :
+  port(0),
+  mask(0) {}
+};
+
+enum EventPeriodType
+{
+  EVENT_PERIOD_FIXED,
+  EVENT_PERIOD_UNIFORM,
+  EVENT_PERIOD_EXPONENTIAL,
+};
+
+struct EventPeriod
+{
+  uint8_t type;
+  uint32_t period_min_ms;
+  uint32_t period_max_ms;
+};
+
+struct EventTask
+{
+  Functor1wRet<EventTask &,int32_t> functor;
+  uint16_t step;
+  int arg;
+};
+
+enum EventRampType
+{
+  EVENT_RAMP_LINEAR,
+  EVENT_RAMP_EXPONENTIAL,
+  EVENT_RAMP_TABLE,
+};
+struct EventRampPoint
+{
+  uint16_t step;
+  int32_t value;
+};
+struct EventRamp
+{
+  uint8_t type;
+  int32_t value;
+  uint16_t fraction;
+  int32_t delta;
+  uint16_t delta_fraction;
+  uint32_t ratio_q16;
+  int32_t value_stop;
+  uint16_t step_remaining;
+  const EventRampPoint * points;
+  uint8_t point_count;
+  uint8_t point_index;
+  EventRamp() :
+  type(EVENT_RAMP_LINEAR),
+  value(0),
+  fraction(0),
+  delta(0),
+  delta_fraction(0),
+  ratio_q16(0),
+  value_stop(0),
+  step_remaining(0),
+  points(NULL),
+  point_count(0),
+  point_index(0) {}
+};
 
 struct Event
 {
   Functor1<int> functor;
+  Functor1<int> functor_start;
+  Functor1<int> functor_stop;
   uint32_t time_start;
   uint32_t time;
+  uint32_t period_ms;
+  uint32_t coincident_cost_us;
+  EventTask * task;
+  EventPeriod * period;
+  EventRamp * ramp;
+  PortAction port_action;
+  uint16_t count;
+  uint16_t inc;
+  int arg;
+  uint16_t cost_us;
   bool free;
   bool enabled;
   bool infinite;
+  bool armed;
+  uint8_t group_index;
+  uint8_t trigger_group;
+  uint8_t affinity;
+  uint8_t bank;
+};
+struct GroupFunctor
+{
+  Functor1<int> functor;
+  int arg;
+  PortAction port_action;
+  uint32_t time_start;
+  uint8_t event_index;
+  uint8_t next_index;
+  bool enabled;
+  bool free;
+};
+struct PwmChannel
+{
+  Functor1<int> functor_0;
+  Functor1<int> functor_1;
+  Functor1<int> functor_start;
+  Functor1<int> functor_stop;
+  uint32_t time_start;
+  uint32_t time;
   uint32_t period_ms;
+  uint32_t on_duration_ms;
   uint16_t count;
   uint16_t inc;
   int arg;
-  Functor1<int> functor_start;
-  Functor1<int> functor_stop;
+  uint8_t next_index;
+  bool free;
+  bool enabled;
+  bool infinite;
+  bool on;
+};
+struct InputSource
+{
+  Functor1<int> functor_rising;
+  Functor1<int> functor_falling;
+  volatile PortRegister * port;
+  PortRegister mask;
+  PortRegister state;
+  PortRegister count_0;
+  PortRegister count_1;
+  uint32_t time_start;
+  uint32_t time;
+  bool debounce;
+  bool free;
+  bool enabled;
+};
+
+enum EventTraceType
+{
+  EVENT_TRACE_START,
+  EVENT_TRACE_MAIN,
+  EVENT_TRACE_STOP,
+};
+struct EventTrace
+{
+  uint8_t event_index;
+  uint8_t type;
+  uint32_t time;
+  uint32_t millis;
+};
+enum EventCommandType
+{
+  EVENT_COMMAND_ENABLE,
+  EVENT_COMMAND_DISABLE,
+  EVENT_COMMAND_REMOVE,
+  EVENT_COMMAND_CLEAR,
+  EVENT_COMMAND_REPLACE_FUNCTOR,
+  EVENT_COMMAND_ADD_START_FUNCTOR,
+  EVENT_COMMAND_ADD_STOP_FUNCTOR,
 };
 struct EventId
 {
@@ -47,13 +227,47 @@ struct EventIdPair
   event_id_1(EventId()) {}
 };
 
+struct EventCommand
+{
+  uint8_t type;
+  EventId event_id;
+  Functor1<int> functor;
+};
+
+template <uint8_t EVENT_COUNT_MAX>
+struct EventBuffer
+{
+  Event events[EVENT_COUNT_MAX];
+  Event * data()
+  {
+    return events;
+  }
+};
+template <>
+struct EventBuffer<0>
+{
+  Event * data()
+  {
+    return NULL;
+  }
+};
+
 template <uint8_t EVENT_COUNT_MAX>
 class EventController
 {
 public:
   EventController();
   enum{MICRO_SEC_PER_MILLI_SEC=1000};
+  enum{TRACE_SIZE=10};
+  enum{TASK_DONE=-1};
   void setup(size_t timer_number=1);
+  void setup(EventTimer & event_timer);
+  void setup(Event * event_buffer,
+    uint8_t event_count_max,
+    size_t timer_number=1);
+  void setup(Event * event_buffer,
+    uint8_t event_count_max,
+    EventTimer & event_timer);
   uint32_t getTime();
   void setTime(uint32_t time=0);
   EventId addEvent(const Functor1<int> & functor,
@@ -104,6 +318,10 @@ public:
     uint32_t offset,
     uint32_t period_ms,
     int arg=-1);
+  EventId addTaskUsingTime(EventTask & task,
+    uint32_t time);
+  EventId addTaskUsingDelay(EventTask & task,
+    uint32_t delay);
   EventIdPair addPwmUsingTime(const Functor1<int> & functor_0,
     const Functor1<int> & functor_1,
     uint32_t time,
@@ -158,6 +376,51 @@ public:
   void replaceFunctors(const EventIdPair event_id_pair,
     const Functor1<int> & functor_0,
     const Functor1<int> & functor_1);
+  EventId addGroupFunctor(const EventId event_id,
+    const Functor1<int> & functor,
+    int arg=-1);
+  EventIdPair addGroupFunctors(const EventIdPair event_id_pair,
+    const Functor1<int> & functor_0,
+    const Functor1<int> & functor_1,
+    int arg=-1);
+  void setupGroupFunctors(GroupFunctor * group_functor_buffer,
+    uint8_t group_functor_count_max);
+  void removeGroupFunctor(const EventId group_functor_id);
+  void removeGroupFunctors(const EventIdPair group_functor_id_pair);
+  void setGroupFunctorPortAction(const EventId group_functor_id,
+    const PortAction & port_action);
+  void enableGroupFunctor(const EventId group_functor_id);
+  void disableGroupFunctor(const EventId group_functor_id);
+  uint8_t groupFunctorsAvailable();
+  void setAffinity(const EventId event_id,
+    uint8_t affinity);
+  void setAffinity(const EventIdPair event_id_pair,
+    uint8_t affinity);
+  void setRandomPeriod(const EventId event_id,
+    EventPeriod & period);
+  void seedRandom(uint32_t seed);
+  void setRamp(const EventId event_id,
+    EventRamp & ramp);
+  void setPortAction(const EventId event_id,
+    const PortAction & port_action);
+  void setPortActions(const EventIdPair event_id_pair,
+    const PortAction & port_action_0,
+    const PortAction & port_action_1);
+  void restart(const EventId event_id,
+    uint32_t delay);
+  void restart(const EventIdPair event_id_pair,
+    uint32_t delay);
+  void extend(const EventId event_id,
+    uint32_t delta);
+  void extend(const EventIdPair event_id_pair,
+    uint32_t delta);
+  void arm(const EventId event_id,
+    uint8_t trigger_group=0);
+  void arm(const EventIdPair event_id_pair,
+    uint8_t trigger_group=0);
+  void trigger(uint8_t trigger_group=0);
+  void triggerUsingCaptureTime(uint8_t trigger_group,
+    uint32_t capture_time_us);
   void remove(const EventId event_id);
   void remove(const EventIdPair event_id_pair);
   void removeAllEvents();
@@ -174,21 +437,211 @@ public:
   uint8_t eventsActive();
   uint8_t eventsAvailable();
   Array<Event,EVENT_COUNT_MAX> getEventArray();
+  uint8_t getEventCountMax();
+  void setupTrace(EventTrace * trace_buffer,
+    uint8_t trace_count_max);
+  bool getTrace(EventTrace & trace);
+  uint8_t drainTrace(Print & print,
+    uint8_t trace_count=255);
+  uint16_t getTraceOverflowCount();
+  void setupCommandQueue(EventCommand * command_buffer,
+    uint8_t command_count_max);
+  uint8_t commandsAvailable();
+  void setupDispatcher(EventDispatcher * dispatcher);
+  void beginBank();
+  void swapBanksUsingTime(uint32_t time);
+  void swapBanksUsingDelay(uint32_t delay);
+  void clearInactiveBank();
+  uint8_t getActiveBank();
+  void setTickBudget(uint16_t budget_us);
+  void setDefaultCostEstimate(uint16_t cost_us);
+  bool setCostEstimate(const EventId event_id,
+    uint16_t cost_us);
+  void enableCostMeasurement();
+  void disableCostMeasurement();
+  uint32_t getProjectedTickCost();
+  uint8_t getProjectedUtilization();
+  void setupPwmChannels(PwmChannel * pwm_channel_buffer,
+    uint8_t pwm_channel_count_max);
+  EventId addPwmChannelUsingTime(const Functor1<int> & functor_0,
+    const Functor1<int> & functor_1,
+    uint32_t time,
+    uint32_t period_ms,
+    uint32_t on_duration_ms,
+    int32_t count,
+    int arg=-1);
+  EventId addPwmChannelUsingDelay(const Functor1<int> & functor_0,
+    const Functor1<int> & functor_1,
+    uint32_t delay,
+    uint32_t period_ms,
+    uint32_t on_duration_ms,
+    int32_t count,
+    int arg=-1);
+  void addPwmChannelStartFunctor(const EventId pwm_channel_id,
+    const Functor1<int> & functor);
+  void addPwmChannelStopFunctor(const EventId pwm_channel_id,
+    const Functor1<int> & functor);
+  void enablePwmChannel(const EventId pwm_channel_id);
+  void disablePwmChannel(const EventId pwm_channel_id);
+  void removePwmChannel(const EventId pwm_channel_id);
+  uint8_t pwmChannelsActive();
+  uint8_t pwmChannelsAvailable();
+  void setupInputSources(InputSource * input_source_buffer,
+    uint8_t input_source_count_max);
+  EventId addInputSource(const PortInput & port_input,
+    const Functor1<int> & functor_rising,
+    const Functor1<int> & functor_falling,
+    bool debounce=true);
+  void enableInputSource(const EventId input_source_id);
+  void disableInputSource(const EventId input_source_id);
+  void removeInputSource(const EventId input_source_id);
+  PortRegister getInputState(const EventId input_source_id);
+  uint32_t getInputTime(const EventId input_source_id);
+  uint8_t inputSourcesActive();
+  uint8_t inputSourcesAvailable();
 private:
+  enum{RANDOM_SEED_DEFAULT=88675123L};
+  enum{LN2_Q16=45426L};
+  enum{LOG2_FIT_Q16=22714L};
+  enum{BANK_COUNT=2};
   volatile uint32_t millis_;
-  Array<Event,EVENT_COUNT_MAX> event_array_;
+  EventBuffer<EVENT_COUNT_MAX> event_buffer_;
+  Event * event_array_;
+  uint8_t event_count_max_;
   const Functor1<int> functor_dummy_;
   size_t timer_number_;
+  EventTimer * event_timer_;
+  EventDispatcher * dispatcher_;
+  EventTrace * trace_buffer_;
+  uint8_t trace_count_max_;
+  volatile uint8_t trace_head_;
+  volatile uint8_t trace_tail_;
+  volatile uint16_t trace_overflow_count_;
+  EventCommand * command_buffer_;
+  uint8_t command_count_max_;
+  volatile uint8_t command_head_;
+  volatile uint8_t command_tail_;
+  volatile bool updating_;
+  GroupFunctor * group_functor_array_;
+  uint8_t group_functor_count_max_;
+  PwmChannel * pwm_channel_array_;
+  uint8_t pwm_channel_count_max_;
+  uint8_t pwm_channel_head_;
+  uint8_t pwm_channel_due_head_;
+  uint8_t pwm_channel_ready_head_;
+  uint8_t pwm_channel_ready_tail_;
+  uint8_t pwm_channel_updating_;
+  uint32_t pwm_channel_epoch_;
+  InputSource * input_source_array_;
+  uint8_t input_source_count_max_;
+  uint32_t random_state_;
+  uint16_t tick_budget_us_;
+  uint16_t cost_estimate_us_;
+  volatile bool cost_measurement_enabled_;
+  volatile bool coincident_cost_valid_;
+  volatile uint8_t bank_active_;
+  uint8_t bank_build_;
+  volatile bool bank_swap_pending_;
+  uint32_t bank_swap_time_;
+  uint32_t bank_epoch_[BANK_COUNT];
 
+  void setEventBuffer(Event * event_buffer,
+    uint8_t event_count_max);
+  void setupEventArray();
   void startTimer();
   uint8_t findAvailableEventIndex();
+  uint32_t getBuildTime();
+  void rebase(uint32_t time);
+  void resetBanks();
+  void swapBanks();
   void update();
   void remove(uint8_t event_index);
   void clear(uint8_t event_index);
   void enable(uint8_t event_index);
   void disable(uint8_t event_index);
+  bool valid(const EventId event_id);
+  bool validGroupFunctor(const EventId group_functor_id);
+  void clearGroupFunctor(uint8_t group_functor_index);
+  uint32_t nextRandom();
+  uint32_t drawPeriod(const Event & event);
+  uint32_t greatestCommonDivisor(uint32_t a,
+    uint32_t b);
+  bool phaseKnown(const Event & event);
+  bool coincident(const Event & event,
+    uint32_t time,
+    uint32_t period_ms);
+  bool coincident(const Event & event,
+    const Event & other);
+  bool coincidentCostsTracked();
+  void updateCoincidentCosts();
+  void attachCoincidentCost(uint8_t event_index);
+  void adjustCoincidentCost(uint8_t event_index,
+    uint32_t cost_delta_us);
+  bool admit(uint32_t time,
+    uint32_t period_ms,
+    uint8_t bank,
+    bool phase_known,
+    uint32_t cost_us,
+    uint8_t event_index_exclude=255);
+  void measureCost(Event & event,
+    uint32_t time_start_us);
+  void applyPortAction(const PortAction & port_action);
+  void dispatch(const Functor1<int> & functor,
+    int arg,
+    uint8_t affinity);
+  void trace(uint8_t event_index,
+    uint8_t type,
+    uint32_t time);
+  bool postCommand(uint8_t type,
+    const EventId event_id,
+    const Functor1<int> & functor=Functor1<int>());
+  void processCommands();
+  bool validPwmChannel(const EventId pwm_channel_id);
+  void skipPwmChannelPeriods(uint8_t pwm_channel_index,
+    uint32_t time);
+  void insertPwmChannel(uint8_t pwm_channel_index);
+  void appendReadyPwmChannel(uint8_t pwm_channel_index);
+  void mergeReadyPwmChannels();
+  void unlinkPwmChannel(uint8_t pwm_channel_index);
+  void clearPwmChannel(uint8_t pwm_channel_index);
+  void updatePwmChannels();
+  bool validInputSource(const EventId input_source_id);
+  void syncInputSource(InputSource & input_source);
+  void clearInputSource(uint8_t input_source_index);
+  void updateInputSources();
+  void applyCommand(const EventCommand & command);
+  void arm(const EventId event_id,
+    uint8_t trigger_group,
+    uint32_t time_now);
+  void triggerUsingTime(uint8_t trigger_group,
+    uint32_t time);
 };
 
+PortAction makePortAction(uint8_t pin,
+  uint8_t type);
+bool addPinToPortAction(PortAction & port_action,
+  uint8_t pin);
+PortInput makePortInput(uint8_t pin);
+bool addPinToPortInput(PortInput & port_input,
+  uint8_t pin);
+
+EventPeriod makeRandomPeriod(uint8_t period_type,
+  uint32_t period_min_ms,
+  uint32_t period_max_ms);
+EventRamp makeLinearRamp(int32_t value_start,
+  int32_t value_stop,
+  uint16_t step_count);
+EventRamp makeExponentialRamp(int32_t value_start,
+  int32_t value_stop,
+  uint32_t ratio_q16);
+EventRamp makeTableRamp(const EventRampPoint * points,
+  uint8_t point_count);
+void advanceRamp(EventRamp & ramp);
+
+InterruptState saveInterrupts();
+void restoreInterrupts(InterruptState interrupt_state);
+bool interruptContext();
+
 bool operator==(const EventId& lhs,
   const EventId& rhs);
 bool operator==(const EventIdPair& lhs,
@@ -5,9 +5,285 @@
 // Authors:
 // Peter Polidoro peterpolidoro@gmail.com
 // ----------------------------------------------------------------------------
+#include <limits.h>
+
 #include "../EventController.h"
 
 
+PortAction makePortAction(uint8_t pin,
+  uint8_t type)
+{
+  PortAction port_action;
+#if defined(ARDUINO)
+  uint8_t port = digitalPinToPort(pin);
+  if (port != NOT_A_PIN)
+  {
+    port_action.port = (volatile PortRegister *)portOutputRegister(port);
+    port_action.mask = digitalPinToBitMask(pin);
+    port_action.type = type;
+  }
+#endif
+  return port_action;
+}
+
+bool addPinToPortAction(PortAction & port_action,
+  uint8_t pin)
+{
+#if defined(ARDUINO)
+  uint8_t port = digitalPinToPort(pin);
+  if ((port == NOT_A_PIN) ||
+    (port_action.port != (volatile PortRegister *)portOutputRegister(port)))
+  {
+    return false;
+  }
+  port_action.mask |= digitalPinToBitMask(pin);
+  return true;
+#else
+  return false;
+#endif
+}
+
+PortInput makePortInput(uint8_t pin)
+{
+  PortInput port_input;
+#if defined(ARDUINO)
+  uint8_t port = digitalPinToPort(pin);
+  if (port != NOT_A_PIN)
+  {
+    port_input.port = (volatile PortRegister *)portInputRegister(port);
+    port_input.mask = digitalPinToBitMask(pin);
+  }
+#endif
+  return port_input;
+}
+
+bool addPinToPortInput(PortInput & port_input,
+  uint8_t pin)
+{
+#if defined(ARDUINO)
+  uint8_t port = digitalPinToPort(pin);
+  if ((port == NOT_A_PIN) ||
+    (port_input.port != (volatile PortRegister *)portInputRegister(port)))
+  {
+    return false;
+  }
+  port_input.mask |= digitalPinToBitMask(pin);
+  return true;
+#else
+  return false;
+#endif
+}
+
+// ramp values are passed to functors as int, which is 16 bits on AVR
+static int32_t clampRampValue(int32_t value)
+{
+  if (value > INT_MAX)
+  {
+    return INT_MAX;
+  }
+  if (value < INT_MIN)
+  {
+    return INT_MIN;
+  }
+  return value;
+}
+
+static void setRampSlope(EventRamp & ramp,
+  int32_t value_stop,
+  uint16_t step_count)
+{
+  ramp.fraction = 0;
+  ramp.value_stop = value_stop;
+  ramp.step_remaining = step_count;
+  if (step_count == 0)
+  {
+    ramp.delta = 0;
+    ramp.delta_fraction = 0;
+    return;
+  }
+  int64_t slope_q16 = ((int64_t)value_stop - ramp.value)*65536/step_count;
+  ramp.delta = (int32_t)(slope_q16 >> 16);
+  ramp.delta_fraction = slope_q16 & 0xFFFF;
+}
+
+static void startRampSegment(EventRamp & ramp)
+{
+  while ((ramp.point_index + 1) < ramp.point_count)
+  {
+    const EventRampPoint & point = ramp.points[ramp.point_index];
+    const EventRampPoint & point_next = ramp.points[++ramp.point_index];
+    ramp.value = clampRampValue(point.value);
+    if (point_next.step > point.step)
+    {
+      setRampSlope(ramp,clampRampValue(point_next.value),point_next.step - point.step);
+      return;
+    }
+  }
+  if (ramp.point_count > 0)
+  {
+    ramp.value = clampRampValue(ramp.points[ramp.point_count - 1].value);
+  }
+  setRampSlope(ramp,ramp.value,0);
+}
+
+EventPeriod makeRandomPeriod(uint8_t period_type,
+  uint32_t period_min_ms,
+  uint32_t period_max_ms)
+{
+  if (period_min_ms == 0)
+  {
+    period_min_ms = 1;
+  }
+  if (period_max_ms < period_min_ms)
+  {
+    period_max_ms = period_min_ms;
+  }
+  EventPeriod period;
+  period.type = period_type;
+  period.period_min_ms = period_min_ms;
+  period.period_max_ms = period_max_ms;
+  return period;
+}
+
+EventRamp makeLinearRamp(int32_t value_start,
+  int32_t value_stop,
+  uint16_t step_count)
+{
+  value_start = clampRampValue(value_start);
+  value_stop = clampRampValue(value_stop);
+  EventRamp ramp;
+  ramp.type = EVENT_RAMP_LINEAR;
+  ramp.value = value_start;
+  if (step_count > 1)
+  {
+    setRampSlope(ramp,value_stop,step_count - 1);
+  }
+  else
+  {
+    ramp.value = value_stop;
+    setRampSlope(ramp,value_stop,0);
+  }
+  return ramp;
+}
+
+EventRamp makeExponentialRamp(int32_t value_start,
+  int32_t value_stop,
+  uint32_t ratio_q16)
+{
+  value_start = clampRampValue(value_start);
+  value_stop = clampRampValue(value_stop);
+  // a ramp that can only move away from value_stop would leave the int
+  // range, so it holds value_start instead
+  int64_t magnitude_start = (value_start < 0) ? -(int64_t)value_start : value_start;
+  int64_t magnitude_stop = (value_stop < 0) ? -(int64_t)value_stop : value_stop;
+  bool converges = (value_start != 0) &&
+    ((value_start < 0) == (value_stop < 0)) &&
+    ((magnitude_stop > magnitude_start) ? (ratio_q16 > 0x10000) : (ratio_q16 < 0x10000));
+  EventRamp ramp;
+  ramp.type = EVENT_RAMP_EXPONENTIAL;
+  ramp.value = value_start;
+  ramp.value_stop = value_stop;
+  ramp.ratio_q16 = ratio_q16;
+  ramp.step_remaining = (value_start != value_stop) && converges;
+  return ramp;
+}
+
+EventRamp makeTableRamp(const EventRampPoint * points,
+  uint8_t point_count)
+{
+  EventRamp ramp;
+  ramp.type = EVENT_RAMP_TABLE;
+  ramp.points = points;
+  ramp.point_count = point_count;
+  ramp.point_index = 0;
+  startRampSegment(ramp);
+  return ramp;
+}
+
+void advanceRamp(EventRamp & ramp)
+{
+  if (ramp.step_remaining == 0)
+  {
+    return;
+  }
+  if (ramp.type == EVENT_RAMP_EXPONENTIAL)
+  {
+    int64_t value_q16 = (int64_t)ramp.value*ramp.ratio_q16 + (((uint64_t)ramp.fraction*ramp.ratio_q16) >> 16);
+    int32_t value = (int32_t)(value_q16 >> 16);
+    if ((ramp.value_stop >= ramp.value) ? (value >= ramp.value_stop) : (value <= ramp.value_stop))
+    {
+      ramp.value = ramp.value_stop;
+      ramp.fraction = 0;
+      ramp.step_remaining = 0;
+    }
+    else
+    {
+      ramp.value = value;
+      ramp.fraction = value_q16 & 0xFFFF;
+    }
+    return;
+  }
+  if (--ramp.step_remaining > 0)
+  {
+    uint32_t fraction = (uint32_t)ramp.fraction + ramp.delta_fraction;
+    ramp.value += ramp.delta + (int32_t)(fraction >> 16);
+    ramp.fraction = fraction & 0xFFFF;
+  }
+  else
+  {
+    ramp.value = ramp.value_stop;
+    ramp.fraction = 0;
+    if (ramp.type == EVENT_RAMP_TABLE)
+    {
+      startRampSegment(ramp);
+    }
+  }
+}
+
+InterruptState saveInterrupts()
+{
+#if defined(__AVR__)
+  InterruptState interrupt_state = SREG;
+#elif defined(ARDUINO) && defined(__arm__)
+  InterruptState interrupt_state;
+  asm volatile("mrs %0, primask" : "=r" (interrupt_state));
+#else
+  InterruptState interrupt_state = 0;
+#endif
+  noInterrupts();
+  return interrupt_state;
+}
+
+void restoreInterrupts(InterruptState interrupt_state)
+{
+#if defined(__AVR__)
+  asm volatile("" ::: "memory");
+  SREG = interrupt_state;
+#elif defined(ARDUINO) && defined(__arm__)
+  if ((interrupt_state & 1) == 0)
+  {
+    interrupts();
+  }
+#else
+  interrupts();
+#endif
+}
+
+bool interruptContext()
+{
+#if defined(__AVR__)
+  return !(SREG & _BV(SREG_I));
+#elif defined(ARDUINO) && defined(__arm__)
+  uint32_t ipsr;
+  uint32_t primask;
+  asm volatile("mrs %0, ipsr" : "=r" (ipsr));
+  asm volatile("mrs %0, primask" : "=r" (primask));
+  return (ipsr != 0) || (primask & 1);
+#else
+  return false;
+#endif
+}
+
 bool operator==(const EventId& lhs,
   const EventId& rhs)
 {
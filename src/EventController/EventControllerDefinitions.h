@@ -13,7 +13,39 @@ template <uint8_t EVENT_COUNT_MAX>
 EventController<EVENT_COUNT_MAX>::EventController()
 {
   timer_number_ = 1;
+  event_timer_ = NULL;
+  dispatcher_ = NULL;
   millis_ = 0;
+  event_array_ = event_buffer_.data();
+  event_count_max_ = EVENT_COUNT_MAX;
+  trace_buffer_ = NULL;
+  trace_count_max_ = 0;
+  trace_head_ = 0;
+  trace_tail_ = 0;
+  trace_overflow_count_ = 0;
+  command_buffer_ = NULL;
+  command_count_max_ = 0;
+  command_head_ = 0;
+  command_tail_ = 0;
+  updating_ = false;
+  group_functor_array_ = NULL;
+  group_functor_count_max_ = 0;
+  pwm_channel_array_ = NULL;
+  pwm_channel_count_max_ = 0;
+  pwm_channel_head_ = 255;
+  pwm_channel_due_head_ = 255;
+  pwm_channel_ready_head_ = 255;
+  pwm_channel_ready_tail_ = 255;
+  pwm_channel_updating_ = 255;
+  pwm_channel_epoch_ = 0;
+  input_source_array_ = NULL;
+  input_source_count_max_ = 0;
+  random_state_ = RANDOM_SEED_DEFAULT;
+  tick_budget_us_ = 0;
+  cost_estimate_us_ = 0;
+  cost_measurement_enabled_ = false;
+  coincident_cost_valid_ = false;
+  resetBanks();
 }
 
 template <uint8_t EVENT_COUNT_MAX>
@@ -27,11 +59,37 @@ void EventController<EVENT_COUNT_MAX>::setup(size_t timer_number)
   {
     timer_number_ = 1;
   }
-  event_array_.fill(Event());
-  removeAllEvents();
+  event_timer_ = NULL;
+  setupEventArray();
+  startTimer();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setup(EventTimer & event_timer)
+{
+  event_timer_ = &event_timer;
+  setupEventArray();
   startTimer();
 }
 
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setup(Event * event_buffer,
+  uint8_t event_count_max,
+  size_t timer_number)
+{
+  setEventBuffer(event_buffer,event_count_max);
+  setup(timer_number);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setup(Event * event_buffer,
+  uint8_t event_count_max,
+  EventTimer & event_timer)
+{
+  setEventBuffer(event_buffer,event_count_max);
+  setup(event_timer);
+}
+
 template <uint8_t EVENT_COUNT_MAX>
 uint32_t EventController<EVENT_COUNT_MAX>::getTime()
 {
@@ -46,7 +104,7 @@ template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::setTime(uint32_t time)
 {
   noInterrupts();
-  millis_ = time;
+  rebase(time);
   interrupts();
 }
 
@@ -55,7 +113,7 @@ EventId EventController<EVENT_COUNT_MAX>::addEvent(const Functor1<int> & functor
   int arg)
 {
   return addEventUsingTime(functor,
-    0,
+    getBuildTime(),
     arg);
 }
 
@@ -71,7 +129,7 @@ EventId EventController<EVENT_COUNT_MAX>::addRecurringEvent(const Functor1<int>
     return addInfiniteRecurringEvent(functor,period_ms,arg);
   }
   return addRecurringEventUsingTime(functor,
-    0,
+    getBuildTime(),
     period_ms,
     count,
     arg);
@@ -83,7 +141,7 @@ EventId EventController<EVENT_COUNT_MAX>::addInfiniteRecurringEvent(const Functo
   int arg)
 {
   return addInfiniteRecurringEventUsingTime(functor,
-    0,
+    getBuildTime(),
     period_ms,
     arg);
 }
@@ -93,21 +151,30 @@ EventId EventController<EVENT_COUNT_MAX>::addEventUsingTime(const Functor1<int>
   uint32_t time,
   int arg)
 {
+  time -= bank_epoch_[bank_build_];
+  if (!admit(time,0,bank_build_,true,cost_estimate_us_))
+  {
+    return EventId();
+  }
   uint32_t time_start = getTime();
   uint8_t event_index = findAvailableEventIndex();
-  if (event_index < EVENT_COUNT_MAX)
+  if (event_index < event_count_max_)
   {
     Event & event = event_array_[event_index];
     event.functor = functor;
     event.time_start = time_start;
     event.time = time;
-    event.free = false;
     event.enabled = false;
     event.infinite = false;
     event.count = 1;
     event.period_ms = 0;
     event.inc = 0;
     event.arg = arg;
+    event.group_index = 255;
+    event.cost_us = cost_estimate_us_;
+    event.bank = bank_build_;
+    __atomic_store_n(&event.free,false,__ATOMIC_RELEASE);
+    attachCoincidentCost(event_index);
   }
   EventId event_id;
   event_id.index = event_index;
@@ -126,21 +193,30 @@ EventId EventController<EVENT_COUNT_MAX>::addRecurringEventUsingTime(const Funct
   {
     return addInfiniteRecurringEventUsingTime(functor,time,period_ms,arg);
   }
+  time -= bank_epoch_[bank_build_];
+  if (!admit(time,period_ms,bank_build_,true,cost_estimate_us_))
+  {
+    return EventId();
+  }
   uint32_t time_start = getTime();
   uint8_t event_index = findAvailableEventIndex();
-  if (event_index < EVENT_COUNT_MAX)
+  if (event_index < event_count_max_)
   {
     Event & event = event_array_[event_index];
     event.functor = functor;
     event.time_start = time_start;
     event.time = time;
-    event.free = false;
     event.enabled = false;
     event.infinite = false;
     event.period_ms = period_ms;
     event.count = count;
     event.inc = 0;
     event.arg = arg;
+    event.group_index = 255;
+    event.cost_us = cost_estimate_us_;
+    event.bank = bank_build_;
+    __atomic_store_n(&event.free,false,__ATOMIC_RELEASE);
+    attachCoincidentCost(event_index);
   }
   EventId event_id;
   event_id.index = event_index;
@@ -154,21 +230,30 @@ EventId EventController<EVENT_COUNT_MAX>::addInfiniteRecurringEventUsingTime(con
   uint32_t period_ms,
   int arg)
 {
+  time -= bank_epoch_[bank_build_];
+  if (!admit(time,period_ms,bank_build_,true,cost_estimate_us_))
+  {
+    return EventId();
+  }
   uint32_t time_start = getTime();
   uint8_t event_index = findAvailableEventIndex();
-  if (event_index < EVENT_COUNT_MAX)
+  if (event_index < event_count_max_)
   {
     Event & event = event_array_[event_index];
     event.functor = functor;
     event.time_start = time_start;
     event.time = time;
-    event.free = false;
     event.enabled = false;
     event.infinite = true;
     event.period_ms = period_ms;
     event.count = 0;
     event.inc = 0;
     event.arg = arg;
+    event.group_index = 255;
+    event.cost_us = cost_estimate_us_;
+    event.bank = bank_build_;
+    __atomic_store_n(&event.free,false,__ATOMIC_RELEASE);
+    attachCoincidentCost(event_index);
   }
   EventId event_id;
   event_id.index = event_index;
@@ -181,7 +266,7 @@ EventId EventController<EVENT_COUNT_MAX>::addEventUsingDelay(const Functor1<int>
   uint32_t delay,
   int arg)
 {
-  uint32_t time_now = getTime();
+  uint32_t time_now = getBuildTime();
   uint32_t time = time_now + delay;
   return addEventUsingTime(functor,
     time,
@@ -199,7 +284,7 @@ EventId EventController<EVENT_COUNT_MAX>::addRecurringEventUsingDelay(const Func
   {
     return addInfiniteRecurringEventUsingDelay(functor,delay,period_ms,arg);
   }
-  uint32_t time_now = getTime();
+  uint32_t time_now = getBuildTime();
   uint32_t time = time_now + delay;
   return addRecurringEventUsingTime(functor,
     time,
@@ -214,7 +299,7 @@ EventId EventController<EVENT_COUNT_MAX>::addInfiniteRecurringEventUsingDelay(co
   uint32_t period_ms,
   int arg)
 {
-  uint32_t time_now = getTime();
+  uint32_t time_now = getBuildTime();
   uint32_t time = time_now + delay;
   return addInfiniteRecurringEventUsingTime(functor,
     time,
@@ -229,9 +314,10 @@ EventId EventController<EVENT_COUNT_MAX>::addEventUsingOffset(const Functor1<int
   int arg)
 {
   uint8_t event_index_origin = event_id_origin.index;
-  if (event_index_origin < EVENT_COUNT_MAX)
+  if (event_index_origin < event_count_max_)
   {
-    uint32_t time_origin = event_array_[event_index_origin].time;
+    const Event & event_origin = event_array_[event_index_origin];
+    uint32_t time_origin = event_origin.time + bank_epoch_[event_origin.bank];
     uint32_t time = time_origin + offset;
     return addEventUsingTime(functor,
       time,
@@ -256,9 +342,10 @@ EventId EventController<EVENT_COUNT_MAX>::addRecurringEventUsingOffset(const Fun
     return addInfiniteRecurringEventUsingOffset(functor,event_id_origin,offset,period_ms,arg);
   }
   uint8_t event_index_origin = event_id_origin.index;
-  if (event_index_origin < EVENT_COUNT_MAX)
+  if (event_index_origin < event_count_max_)
   {
-    uint32_t time_origin = event_array_[event_index_origin].time;
+    const Event & event_origin = event_array_[event_index_origin];
+    uint32_t time_origin = event_origin.time + bank_epoch_[event_origin.bank];
     uint32_t time = time_origin + offset;
     return addRecurringEventUsingTime(functor,
       time,
@@ -280,9 +367,10 @@ EventId EventController<EVENT_COUNT_MAX>::addInfiniteRecurringEventUsingOffset(c
   int arg)
 {
   uint8_t event_index_origin = event_id_origin.index;
-  if (event_index_origin < EVENT_COUNT_MAX)
+  if (event_index_origin < event_count_max_)
   {
-    uint32_t time_origin = event_array_[event_index_origin].time;
+    const Event & event_origin = event_array_[event_index_origin];
+    uint32_t time_origin = event_origin.time + bank_epoch_[event_origin.bank];
     uint32_t time = time_origin + offset;
     return addInfiniteRecurringEventUsingTime(functor,
       time,
@@ -295,6 +383,33 @@ EventId EventController<EVENT_COUNT_MAX>::addInfiniteRecurringEventUsingOffset(c
   }
 }
 
+template <uint8_t EVENT_COUNT_MAX>
+EventId EventController<EVENT_COUNT_MAX>::addTaskUsingTime(EventTask & task,
+  uint32_t time)
+{
+  EventId event_id = addInfiniteRecurringEventUsingTime(functor_dummy_,
+    time,
+    0,
+    task.arg);
+  if (event_id.index < event_count_max_)
+  {
+    task.step = 0;
+    event_array_[event_id.index].task = &task;
+    coincident_cost_valid_ = false;
+  }
+  return event_id;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+EventId EventController<EVENT_COUNT_MAX>::addTaskUsingDelay(EventTask & task,
+  uint32_t delay)
+{
+  uint32_t time_now = getBuildTime();
+  uint32_t time = time_now + delay;
+  return addTaskUsingTime(task,
+    time);
+}
+
 template <uint8_t EVENT_COUNT_MAX>
 EventIdPair EventController<EVENT_COUNT_MAX>::addPwmUsingTime(const Functor1<int> & functor_0,
   const Functor1<int> & functor_1,
@@ -355,7 +470,7 @@ EventIdPair EventController<EVENT_COUNT_MAX>::addPwmUsingDelay(const Functor1<in
   {
     return addInfinitePwmUsingDelay(functor_0,functor_1,delay,period_ms,on_duration_ms,arg);
   }
-  uint32_t time_now = getTime();
+  uint32_t time_now = getBuildTime();
   uint32_t time = time_now + delay;
   return addPwmUsingTime(functor_0,
     functor_1,
@@ -381,9 +496,10 @@ EventIdPair EventController<EVENT_COUNT_MAX>::addPwmUsingOffset(const Functor1<i
     return addInfinitePwmUsingOffset(functor_0,functor_1,event_id_origin,offset,period_ms,on_duration_ms,arg);
   }
   uint8_t event_index_origin = event_id_origin.index;
-  if (event_index_origin < EVENT_COUNT_MAX)
+  if (event_index_origin < event_count_max_)
   {
-    uint32_t time_origin = event_array_[event_index_origin].time;
+    const Event & event_origin = event_array_[event_index_origin];
+    uint32_t time_origin = event_origin.time + bank_epoch_[event_origin.bank];
     uint32_t time = time_origin + offset;
     return addPwmUsingTime(functor_0,
       functor_1,
@@ -445,7 +561,7 @@ EventIdPair EventController<EVENT_COUNT_MAX>::addInfinitePwmUsingDelay(const Fun
   uint32_t on_duration_ms,
   int arg)
 {
-  uint32_t time_now = getTime();
+  uint32_t time_now = getBuildTime();
   uint32_t time = time_now + delay;
   return addInfinitePwmUsingTime(functor_0,
     functor_1,
@@ -465,9 +581,10 @@ EventIdPair EventController<EVENT_COUNT_MAX>::addInfinitePwmUsingOffset(const Fu
   int arg)
 {
   uint8_t event_index_origin = event_id_origin.index;
-  if (event_index_origin < EVENT_COUNT_MAX)
+  if (event_index_origin < event_count_max_)
   {
-    uint32_t time_origin = event_array_[event_index_origin].time;
+    const Event & event_origin = event_array_[event_index_origin];
+    uint32_t time_origin = event_origin.time + bank_epoch_[event_origin.bank];
     uint32_t time = time_origin + offset;
     return addInfinitePwmUsingTime(functor_0,
       functor_1,
@@ -486,8 +603,12 @@ template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::addStartFunctor(const EventId event_id,
   const Functor1<int> & functor)
 {
+  if (postCommand(EVENT_COMMAND_ADD_START_FUNCTOR,event_id,functor))
+  {
+    return;
+  }
   uint8_t event_index = event_id.index;
-  if ((event_index < EVENT_COUNT_MAX) &&
+  if ((event_index < event_count_max_) &&
     (event_array_[event_index].time_start == event_id.time_start) &&
     !event_array_[event_index].free)
   {
@@ -499,8 +620,12 @@ template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::addStopFunctor(const EventId event_id,
   const Functor1<int> & functor)
 {
+  if (postCommand(EVENT_COMMAND_ADD_STOP_FUNCTOR,event_id,functor))
+  {
+    return;
+  }
   uint8_t event_index = event_id.index;
-  if ((event_index < EVENT_COUNT_MAX) &&
+  if ((event_index < event_count_max_) &&
     (event_array_[event_index].time_start == event_id.time_start) &&
     !event_array_[event_index].free)
   {
@@ -512,8 +637,12 @@ template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::replaceFunctor(const EventId event_id,
   const Functor1<int> & functor)
 {
+  if (postCommand(EVENT_COMMAND_REPLACE_FUNCTOR,event_id,functor))
+  {
+    return;
+  }
   uint8_t event_index = event_id.index;
-  if ((event_index < EVENT_COUNT_MAX) &&
+  if ((event_index < event_count_max_) &&
     (event_array_[event_index].time_start == event_id.time_start) &&
     !event_array_[event_index].free)
   {
@@ -525,9 +654,13 @@ template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::addStartFunctor(const EventIdPair event_id_pair,
   const Functor1<int> & functor)
 {
+  if (postCommand(EVENT_COMMAND_ADD_START_FUNCTOR,event_id_pair.event_id_0,functor))
+  {
+    return;
+  }
   const EventId & event_id = event_id_pair.event_id_0;
   uint8_t event_index = event_id.index;
-  if ((event_index < EVENT_COUNT_MAX) &&
+  if ((event_index < event_count_max_) &&
     (event_array_[event_index].time_start == event_id.time_start) &&
     !event_array_[event_index].free)
   {
@@ -539,9 +672,13 @@ template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::addStopFunctor(const EventIdPair event_id_pair,
   const Functor1<int> & functor)
 {
+  if (postCommand(EVENT_COMMAND_ADD_STOP_FUNCTOR,event_id_pair.event_id_0,functor))
+  {
+    return;
+  }
   const EventId & event_id = event_id_pair.event_id_0;
   uint8_t event_index = event_id.index;
-  if ((event_index < EVENT_COUNT_MAX) &&
+  if ((event_index < event_count_max_) &&
     (event_array_[event_index].time_start == event_id.time_start) &&
     !event_array_[event_index].free)
   {
@@ -554,30 +691,358 @@ void EventController<EVENT_COUNT_MAX>::replaceFunctors(const EventIdPair event_i
   const Functor1<int> & functor_0,
   const Functor1<int> & functor_1)
 {
-  const EventId & event_id_0 = event_id_pair.event_id_0;
-  uint8_t event_index_0 = event_id_0.index;
-  if ((event_index_0 < EVENT_COUNT_MAX) &&
-    (event_array_[event_index_0].time_start == event_id_0.time_start) &&
-    !event_array_[event_index_0].free)
+  replaceFunctor(event_id_pair.event_id_0,functor_0);
+  replaceFunctor(event_id_pair.event_id_1,functor_1);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+EventId EventController<EVENT_COUNT_MAX>::addGroupFunctor(const EventId event_id,
+  const Functor1<int> & functor,
+  int arg)
+{
+  if (!valid(event_id))
+  {
+    return EventId();
+  }
+  Event & event = event_array_[event_id.index];
+  if (!admit(event.time,
+      event.period_ms,
+      event.bank,
+      phaseKnown(event),
+      event.cost_us + cost_estimate_us_,
+      event_id.index))
+  {
+    return EventId();
+  }
+  uint32_t time_start = getTime();
+  uint8_t group_functor_index = 0;
+  while ((group_functor_index < group_functor_count_max_) && !group_functor_array_[group_functor_index].free)
+  {
+    ++group_functor_index;
+  }
+  if (group_functor_index >= group_functor_count_max_)
+  {
+    return EventId();
+  }
+  GroupFunctor & group_functor = group_functor_array_[group_functor_index];
+  group_functor.functor = functor;
+  group_functor.arg = arg;
+  group_functor.time_start = time_start;
+  group_functor.event_index = event_id.index;
+  group_functor.port_action = PortAction();
+  group_functor.next_index = 255;
+  group_functor.enabled = true;
+  group_functor.free = false;
+
+  noInterrupts();
+  uint8_t * next_index = &event.group_index;
+  while (*next_index < group_functor_count_max_)
+  {
+    next_index = &group_functor_array_[*next_index].next_index;
+  }
+  *next_index = group_functor_index;
+  event.cost_us += cost_estimate_us_;
+  interrupts();
+  adjustCoincidentCost(event_id.index,cost_estimate_us_);
+
+  EventId group_functor_id;
+  group_functor_id.index = group_functor_index;
+  group_functor_id.time_start = time_start;
+  return group_functor_id;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+EventIdPair EventController<EVENT_COUNT_MAX>::addGroupFunctors(const EventIdPair event_id_pair,
+  const Functor1<int> & functor_0,
+  const Functor1<int> & functor_1,
+  int arg)
+{
+  EventIdPair event_id_pair_group;
+  event_id_pair_group.event_id_0 = addGroupFunctor(event_id_pair.event_id_0,
+    functor_0,
+    arg);
+  event_id_pair_group.event_id_1 = addGroupFunctor(event_id_pair.event_id_1,
+    functor_1,
+    arg);
+  return event_id_pair_group;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setupGroupFunctors(GroupFunctor * group_functor_buffer,
+  uint8_t group_functor_count_max)
+{
+  noInterrupts();
+  for (uint8_t event_index=0; event_index<event_count_max_; ++event_index)
+  {
+    event_array_[event_index].group_index = 255;
+  }
+  group_functor_count_max_ = 0;
+  interrupts();
+  group_functor_array_ = group_functor_buffer;
+  if (group_functor_buffer)
+  {
+    for (uint8_t group_functor_index=0; group_functor_index<group_functor_count_max; ++group_functor_index)
+    {
+      clearGroupFunctor(group_functor_index);
+    }
+    group_functor_count_max_ = group_functor_count_max;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::removeGroupFunctor(const EventId group_functor_id)
+{
+  if (!validGroupFunctor(group_functor_id))
+  {
+    return;
+  }
+  noInterrupts();
+  uint8_t * next_index = &event_array_[group_functor_array_[group_functor_id.index].event_index].group_index;
+  while (*next_index < group_functor_count_max_)
+  {
+    if (*next_index == group_functor_id.index)
+    {
+      *next_index = group_functor_array_[group_functor_id.index].next_index;
+      break;
+    }
+    next_index = &group_functor_array_[*next_index].next_index;
+  }
+  clearGroupFunctor(group_functor_id.index);
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::removeGroupFunctors(const EventIdPair group_functor_id_pair)
+{
+  removeGroupFunctor(group_functor_id_pair.event_id_0);
+  removeGroupFunctor(group_functor_id_pair.event_id_1);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setGroupFunctorPortAction(const EventId group_functor_id,
+  const PortAction & port_action)
+{
+  if (!validGroupFunctor(group_functor_id))
+  {
+    return;
+  }
+  noInterrupts();
+  group_functor_array_[group_functor_id.index].port_action = port_action;
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::enableGroupFunctor(const EventId group_functor_id)
+{
+  if (validGroupFunctor(group_functor_id))
+  {
+    group_functor_array_[group_functor_id.index].enabled = true;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::disableGroupFunctor(const EventId group_functor_id)
+{
+  if (validGroupFunctor(group_functor_id))
+  {
+    group_functor_array_[group_functor_id.index].enabled = false;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::groupFunctorsAvailable()
+{
+  uint8_t group_functors_available = 0;
+  for (uint8_t group_functor_index=0; group_functor_index<group_functor_count_max_; ++group_functor_index)
+  {
+    if (group_functor_array_[group_functor_index].free)
+    {
+      ++group_functors_available;
+    }
+  }
+  return group_functors_available;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setAffinity(const EventId event_id,
+  uint8_t affinity)
+{
+  if (valid(event_id))
+  {
+    event_array_[event_id.index].affinity = affinity;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setAffinity(const EventIdPair event_id_pair,
+  uint8_t affinity)
+{
+  setAffinity(event_id_pair.event_id_0,affinity);
+  setAffinity(event_id_pair.event_id_1,affinity);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setRandomPeriod(const EventId event_id,
+  EventPeriod & period)
+{
+  noInterrupts();
+  if (valid(event_id))
+  {
+    event_array_[event_id.index].period = &period;
+    coincident_cost_valid_ = false;
+  }
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::seedRandom(uint32_t seed)
+{
+  if (seed == 0)
+  {
+    seed = RANDOM_SEED_DEFAULT;
+  }
+  noInterrupts();
+  random_state_ = seed;
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setRamp(const EventId event_id,
+  EventRamp & ramp)
+{
+  noInterrupts();
+  if (valid(event_id))
+  {
+    event_array_[event_id.index].ramp = &ramp;
+  }
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setPortAction(const EventId event_id,
+  const PortAction & port_action)
+{
+  uint8_t event_index = event_id.index;
+  if ((event_index < event_count_max_) &&
+    (event_array_[event_index].time_start == event_id.time_start) &&
+    !event_array_[event_index].free)
+  {
+    event_array_[event_index].port_action = port_action;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setPortActions(const EventIdPair event_id_pair,
+  const PortAction & port_action_0,
+  const PortAction & port_action_1)
+{
+  setPortAction(event_id_pair.event_id_0,port_action_0);
+  setPortAction(event_id_pair.event_id_1,port_action_1);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::restart(const EventId event_id,
+  uint32_t delay)
+{
+  EventIdPair event_id_pair;
+  event_id_pair.event_id_0 = event_id;
+  restart(event_id_pair,delay);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::restart(const EventIdPair event_id_pair,
+  uint32_t delay)
+{
+  InterruptState interrupt_state = saveInterrupts();
+  if (valid(event_id_pair.event_id_0))
   {
-    event_array_[event_index_0].functor = functor_0;
+    Event & event_0 = event_array_[event_id_pair.event_id_0.index];
+    uint32_t delta = millis_ - bank_epoch_[event_0.bank] + delay - event_0.time;
+    event_0.time += delta;
+    event_0.inc = 0;
+    if (valid(event_id_pair.event_id_1))
+    {
+      Event & event_1 = event_array_[event_id_pair.event_id_1.index];
+      event_1.time += delta;
+      event_1.inc = 0;
+    }
+    coincident_cost_valid_ = false;
   }
+  restoreInterrupts(interrupt_state);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::extend(const EventId event_id,
+  uint32_t delta)
+{
+  EventIdPair event_id_pair;
+  event_id_pair.event_id_0 = event_id;
+  extend(event_id_pair,delta);
+}
 
-  const EventId & event_id_1 = event_id_pair.event_id_1;
-  uint8_t event_index_1 = event_id_1.index;
-  if ((event_index_1 < EVENT_COUNT_MAX) &&
-    (event_array_[event_index_1].time_start == event_id_1.time_start) &&
-    !event_array_[event_index_1].free)
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::extend(const EventIdPair event_id_pair,
+  uint32_t delta)
+{
+  InterruptState interrupt_state = saveInterrupts();
+  if (valid(event_id_pair.event_id_0))
+  {
+    event_array_[event_id_pair.event_id_0.index].time += delta;
+  }
+  if (valid(event_id_pair.event_id_1))
   {
-    event_array_[event_index_1].functor = functor_1;
+    event_array_[event_id_pair.event_id_1.index].time += delta;
   }
+  coincident_cost_valid_ = false;
+  restoreInterrupts(interrupt_state);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::arm(const EventId event_id,
+  uint8_t trigger_group)
+{
+  noInterrupts();
+  arm(event_id,trigger_group,millis_);
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::arm(const EventIdPair event_id_pair,
+  uint8_t trigger_group)
+{
+  noInterrupts();
+  arm(event_id_pair.event_id_0,trigger_group,millis_);
+  arm(event_id_pair.event_id_1,trigger_group,millis_);
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::trigger(uint8_t trigger_group)
+{
+  InterruptState interrupt_state = saveInterrupts();
+  triggerUsingTime(trigger_group,millis_);
+  restoreInterrupts(interrupt_state);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::triggerUsingCaptureTime(uint8_t trigger_group,
+  uint32_t capture_time_us)
+{
+  InterruptState interrupt_state = saveInterrupts();
+  uint32_t elapsed_ms = (uint32_t)(micros() - capture_time_us) / MICRO_SEC_PER_MILLI_SEC;
+  triggerUsingTime(trigger_group,millis_ - elapsed_ms);
+  restoreInterrupts(interrupt_state);
 }
 
 template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::remove(const EventId event_id)
 {
+  if (postCommand(EVENT_COMMAND_REMOVE,event_id))
+  {
+    return;
+  }
   uint8_t event_index = event_id.index;
-  if ((event_index < EVENT_COUNT_MAX) && (event_array_[event_index].time_start == event_id.time_start))
+  if ((event_index < event_count_max_) && (event_array_[event_index].time_start == event_id.time_start))
   {
     remove(event_index);
   }
@@ -593,7 +1058,7 @@ void EventController<EVENT_COUNT_MAX>::remove(const EventIdPair event_id_pair)
 template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::remove(uint8_t event_index)
 {
-  if (event_index < EVENT_COUNT_MAX)
+  if (event_index < event_count_max_)
   {
     Event & event = event_array_[event_index];
     if (event.functor_stop)
@@ -607,18 +1072,26 @@ void EventController<EVENT_COUNT_MAX>::remove(uint8_t event_index)
 template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::removeAllEvents()
 {
-  for (size_t i=0; i<EVENT_COUNT_MAX; ++i)
+  coincident_cost_valid_ = false;
+  for (size_t i=0; i<event_count_max_; ++i)
   {
     remove(i);
   }
-  millis_ = 0;
+  noInterrupts();
+  rebase(0);
+  resetBanks();
+  interrupts();
 }
 
 template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::clear(const EventId event_id)
 {
+  if (postCommand(EVENT_COMMAND_CLEAR,event_id))
+  {
+    return;
+  }
   uint8_t event_index = event_id.index;
-  if ((event_index < EVENT_COUNT_MAX) && (event_array_[event_index].time_start == event_id.time_start))
+  if ((event_index < event_count_max_) && (event_array_[event_index].time_start == event_id.time_start))
   {
     clear(event_index);
   }
@@ -634,9 +1107,21 @@ void EventController<EVENT_COUNT_MAX>::clear(const EventIdPair event_id_pair)
 template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::clear(uint8_t event_index)
 {
-  if (event_index < EVENT_COUNT_MAX)
+  if (event_index < event_count_max_)
   {
     Event & event = event_array_[event_index];
+    if (!event.free)
+    {
+      adjustCoincidentCost(event_index,(uint32_t)0 - event.cost_us);
+    }
+    uint8_t group_index = event.group_index;
+    event.group_index = 255;
+    while (group_index < group_functor_count_max_)
+    {
+      uint8_t group_index_next = group_functor_array_[group_index].next_index;
+      clearGroupFunctor(group_index);
+      group_index = group_index_next;
+    }
     event.functor = functor_dummy_;
     event.time_start = 0;
     event.time = 0;
@@ -644,29 +1129,47 @@ void EventController<EVENT_COUNT_MAX>::clear(uint8_t event_index)
     event.enabled = false;
     event.infinite = false;
     event.period_ms = 0;
+    event.coincident_cost_us = 0;
     event.count = 0;
     event.inc = 0;
     event.arg = -1;
     event.functor_start = functor_dummy_;
     event.functor_stop = functor_dummy_;
+    event.port_action = PortAction();
+    event.armed = false;
+    event.trigger_group = 0;
+    event.task = NULL;
+    event.affinity = EventDispatcher::AFFINITY_ANY;
+    event.period = NULL;
+    event.ramp = NULL;
+    event.cost_us = 0;
+    event.bank = 0;
   }
 }
 
 template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::clearAllEvents()
 {
-  for (size_t i=0; i<EVENT_COUNT_MAX; ++i)
+  coincident_cost_valid_ = false;
+  for (size_t i=0; i<event_count_max_; ++i)
   {
     clear(i);
   }
-  millis_ = 0;
+  noInterrupts();
+  rebase(0);
+  resetBanks();
+  interrupts();
 }
 
 template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::enable(const EventId event_id)
 {
+  if (postCommand(EVENT_COMMAND_ENABLE,event_id))
+  {
+    return;
+  }
   uint8_t event_index = event_id.index;
-  if ((event_index < EVENT_COUNT_MAX) &&
+  if ((event_index < event_count_max_) &&
     (event_array_[event_index].time_start == event_id.time_start) &&
     !event_array_[event_index].free)
   {
@@ -684,7 +1187,7 @@ void EventController<EVENT_COUNT_MAX>::enable(const EventIdPair event_id_pair)
 template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::enable(uint8_t event_index)
 {
-  if ((event_index < EVENT_COUNT_MAX) && !event_array_[event_index].free)
+  if ((event_index < event_count_max_) && !event_array_[event_index].free)
   {
     event_array_[event_index].enabled = true;
   }
@@ -693,8 +1196,12 @@ void EventController<EVENT_COUNT_MAX>::enable(uint8_t event_index)
 template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::disable(const EventId event_id)
 {
+  if (postCommand(EVENT_COMMAND_DISABLE,event_id))
+  {
+    return;
+  }
   uint8_t event_index = event_id.index;
-  if ((event_index < EVENT_COUNT_MAX) &&
+  if ((event_index < event_count_max_) &&
     (event_array_[event_index].time_start == event_id.time_start) &&
     !event_array_[event_index].free)
   {
@@ -712,156 +1219,1668 @@ void EventController<EVENT_COUNT_MAX>::disable(const EventIdPair event_id_pair)
 template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::disable(uint8_t event_index)
 {
-  if ((event_index < EVENT_COUNT_MAX) && !event_array_[event_index].free)
+  if ((event_index < event_count_max_) && !event_array_[event_index].free)
   {
     event_array_[event_index].enabled = false;
   }
 }
 
 template <uint8_t EVENT_COUNT_MAX>
-Event EventController<EVENT_COUNT_MAX>::getEvent(const EventId event_id)
+bool EventController<EVENT_COUNT_MAX>::valid(const EventId event_id)
 {
   uint8_t event_index = event_id.index;
-  if (event_index < EVENT_COUNT_MAX)
-  {
-    return event_array_[event_index];
-  }
-  else
-  {
+  return ((event_index < event_count_max_) &&
+    (event_array_[event_index].time_start == event_id.time_start) &&
+    !event_array_[event_index].free);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+bool EventController<EVENT_COUNT_MAX>::validGroupFunctor(const EventId group_functor_id)
+{
+  uint8_t group_functor_index = group_functor_id.index;
+  return ((group_functor_index < group_functor_count_max_) &&
+    (group_functor_array_[group_functor_index].time_start == group_functor_id.time_start) &&
+    !group_functor_array_[group_functor_index].free);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::clearGroupFunctor(uint8_t group_functor_index)
+{
+  GroupFunctor & group_functor = group_functor_array_[group_functor_index];
+  group_functor.functor = functor_dummy_;
+  group_functor.arg = -1;
+  group_functor.time_start = 0;
+  group_functor.event_index = 255;
+  group_functor.port_action = PortAction();
+  group_functor.next_index = 255;
+  group_functor.enabled = false;
+  group_functor.free = true;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+Event EventController<EVENT_COUNT_MAX>::getEvent(const EventId event_id)
+{
+  return getEvent(event_id.index);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+Event EventController<EVENT_COUNT_MAX>::getEvent(uint8_t event_index)
+{
+  if (event_index < event_count_max_)
+  {
+    Event event = event_array_[event_index];
+    if (!event.armed)
+    {
+      event.time += bank_epoch_[event.bank];
+    }
+    return event;
+  }
+  else
+  {
     return Event();
   }
 }
 
 template <uint8_t EVENT_COUNT_MAX>
-Event EventController<EVENT_COUNT_MAX>::getEvent(uint8_t event_index)
+void EventController<EVENT_COUNT_MAX>::setEventArgToEventIndex(const EventId event_id)
+{
+  uint8_t event_index = event_id.index;
+  if (event_index < event_count_max_)
+  {
+    event_array_[event_index].arg = event_index;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::eventsActive()
+{
+  uint8_t events_active = 0;
+  for (uint8_t event_index=0; event_index<event_count_max_; ++event_index)
+  {
+    if ((!event_array_[event_index].free) && event_array_[event_index].enabled)
+    {
+      ++events_active;
+    }
+  }
+  return events_active;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::eventsAvailable()
+{
+  uint8_t events_available = 0;
+  for (uint8_t event_index=0; event_index<event_count_max_; ++event_index)
+  {
+    if (event_array_[event_index].free)
+    {
+      ++events_available;
+    }
+  }
+  return events_available;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+Array<Event,EVENT_COUNT_MAX> EventController<EVENT_COUNT_MAX>::getEventArray()
+{
+  Array<Event,EVENT_COUNT_MAX> event_array;
+  for (uint8_t event_index=0; (event_index<event_count_max_) && (event_index<EVENT_COUNT_MAX); ++event_index)
+  {
+    event_array.push_back(getEvent(event_index));
+  }
+  return event_array;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::getEventCountMax()
+{
+  return event_count_max_;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setupTrace(EventTrace * trace_buffer,
+  uint8_t trace_count_max)
+{
+  noInterrupts();
+  if (trace_buffer)
+  {
+    trace_buffer_ = trace_buffer;
+    trace_count_max_ = trace_count_max;
+  }
+  else
+  {
+    trace_buffer_ = NULL;
+    trace_count_max_ = 0;
+  }
+  trace_head_ = 0;
+  trace_tail_ = 0;
+  trace_overflow_count_ = 0;
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+bool EventController<EVENT_COUNT_MAX>::getTrace(EventTrace & trace)
+{
+  uint8_t trace_tail = trace_tail_;
+  if (trace_tail == trace_head_)
+  {
+    return false;
+  }
+  trace = trace_buffer_[trace_tail];
+  if (++trace_tail == trace_count_max_)
+  {
+    trace_tail = 0;
+  }
+  trace_tail_ = trace_tail;
+  return true;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::drainTrace(Print & print,
+  uint8_t trace_count)
+{
+  uint8_t traces_drained = 0;
+  EventTrace trace;
+  while ((traces_drained < trace_count) && getTrace(trace))
+  {
+    uint8_t data[TRACE_SIZE];
+    data[0] = trace.event_index;
+    data[1] = trace.type;
+    for (uint8_t byte_index=0; byte_index<4; ++byte_index)
+    {
+      data[2 + byte_index] = trace.time >> (8*byte_index);
+      data[6 + byte_index] = trace.millis >> (8*byte_index);
+    }
+    print.write(data,TRACE_SIZE);
+    ++traces_drained;
+  }
+  return traces_drained;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint16_t EventController<EVENT_COUNT_MAX>::getTraceOverflowCount()
+{
+  uint16_t trace_overflow_count;
+  noInterrupts();
+  trace_overflow_count = trace_overflow_count_;
+  interrupts();
+  return trace_overflow_count;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setupCommandQueue(EventCommand * command_buffer,
+  uint8_t command_count_max)
+{
+  noInterrupts();
+  processCommands();
+  if (command_buffer)
+  {
+    command_buffer_ = command_buffer;
+    command_count_max_ = command_count_max;
+  }
+  else
+  {
+    command_buffer_ = NULL;
+    command_count_max_ = 0;
+  }
+  command_head_ = 0;
+  command_tail_ = 0;
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::commandsAvailable()
+{
+  if (command_count_max_ == 0)
+  {
+    return 0;
+  }
+  uint8_t command_tail = command_tail_;
+  uint8_t command_head = command_head_;
+  uint8_t commands_pending = (command_head >= command_tail) ?
+    (command_head - command_tail) :
+    (command_count_max_ - command_tail + command_head);
+  return command_count_max_ - 1 - commands_pending;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setupDispatcher(EventDispatcher * dispatcher)
+{
+  noInterrupts();
+  dispatcher_ = dispatcher;
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::beginBank()
+{
+  noInterrupts();
+  bank_swap_pending_ = false;
+  bank_build_ = bank_active_;
+  interrupts();
+  clearInactiveBank();
+  noInterrupts();
+  bank_build_ = (bank_active_ + 1) % BANK_COUNT;
+  bank_epoch_[bank_build_] = 0;
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::swapBanksUsingTime(uint32_t time)
+{
+  noInterrupts();
+  if (bank_build_ != bank_active_)
+  {
+    bank_swap_time_ = time;
+    bank_swap_pending_ = true;
+  }
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::swapBanksUsingDelay(uint32_t delay)
+{
+  noInterrupts();
+  uint32_t time = millis_ + delay;
+  interrupts();
+  swapBanksUsingTime(time);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::clearInactiveBank()
+{
+  for (uint8_t event_index=0; event_index<event_count_max_; ++event_index)
+  {
+    const Event & event = event_array_[event_index];
+    if (!event.free && (event.bank != bank_active_))
+    {
+      clear(event_index);
+    }
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::getActiveBank()
+{
+  return bank_active_;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setTickBudget(uint16_t budget_us)
+{
+  tick_budget_us_ = budget_us;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setDefaultCostEstimate(uint16_t cost_us)
+{
+  cost_estimate_us_ = cost_us;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+bool EventController<EVENT_COUNT_MAX>::setCostEstimate(const EventId event_id,
+  uint16_t cost_us)
+{
+  if (!valid(event_id))
+  {
+    return false;
+  }
+  const Event & event = event_array_[event_id.index];
+  if (!admit(event.time,
+      event.period_ms,
+      event.bank,
+      phaseKnown(event),
+      cost_us,
+      event_id.index))
+  {
+    return false;
+  }
+  adjustCoincidentCost(event_id.index,(uint32_t)cost_us - event.cost_us);
+  noInterrupts();
+  event_array_[event_id.index].cost_us = cost_us;
+  interrupts();
+  return true;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::enableCostMeasurement()
+{
+  cost_measurement_enabled_ = true;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::disableCostMeasurement()
+{
+  cost_measurement_enabled_ = false;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint32_t EventController<EVENT_COUNT_MAX>::getProjectedTickCost()
+{
+  updateCoincidentCosts();
+  uint32_t tick_cost_max = 0;
+  for (uint8_t event_index=0; event_index<event_count_max_; ++event_index)
+  {
+    const Event & event = event_array_[event_index];
+    if (!event.free && (event.bank == bank_active_))
+    {
+      uint32_t tick_cost = event.cost_us + event.coincident_cost_us;
+      if (tick_cost > tick_cost_max)
+      {
+        tick_cost_max = tick_cost;
+      }
+    }
+  }
+  return tick_cost_max;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::getProjectedUtilization()
+{
+  uint32_t utilization = getProjectedTickCost()*100/MICRO_SEC_PER_MILLI_SEC;
+  if (utilization > 255)
+  {
+    utilization = 255;
+  }
+  return utilization;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setupPwmChannels(PwmChannel * pwm_channel_buffer,
+  uint8_t pwm_channel_count_max)
+{
+  noInterrupts();
+  pwm_channel_head_ = 255;
+  pwm_channel_due_head_ = 255;
+  pwm_channel_ready_head_ = 255;
+  pwm_channel_ready_tail_ = 255;
+  pwm_channel_updating_ = 255;
+  if (pwm_channel_buffer)
+  {
+    pwm_channel_array_ = pwm_channel_buffer;
+    pwm_channel_count_max_ = pwm_channel_count_max;
+  }
+  else
+  {
+    pwm_channel_array_ = NULL;
+    pwm_channel_count_max_ = 0;
+  }
+  interrupts();
+  for (uint8_t pwm_channel_index=0; pwm_channel_index<pwm_channel_count_max_; ++pwm_channel_index)
+  {
+    clearPwmChannel(pwm_channel_index);
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+EventId EventController<EVENT_COUNT_MAX>::addPwmChannelUsingTime(const Functor1<int> & functor_0,
+  const Functor1<int> & functor_1,
+  uint32_t time,
+  uint32_t period_ms,
+  uint32_t on_duration_ms,
+  int32_t count,
+  int arg)
+{
+  if (period_ms == 0)
+  {
+    return EventId();
+  }
+  uint32_t time_start = getTime();
+  uint8_t pwm_channel_index = 0;
+  while ((pwm_channel_index < pwm_channel_count_max_) && !pwm_channel_array_[pwm_channel_index].free)
+  {
+    ++pwm_channel_index;
+  }
+  if (pwm_channel_index < pwm_channel_count_max_)
+  {
+    PwmChannel & pwm_channel = pwm_channel_array_[pwm_channel_index];
+    pwm_channel.functor_0 = functor_0;
+    pwm_channel.functor_1 = functor_1;
+    pwm_channel.time_start = time_start;
+    pwm_channel.period_ms = period_ms;
+    pwm_channel.on_duration_ms = on_duration_ms;
+    pwm_channel.infinite = (count < 0);
+    pwm_channel.count = (count < 0) ? 0 : count;
+    pwm_channel.inc = 0;
+    pwm_channel.arg = arg;
+    pwm_channel.enabled = false;
+    pwm_channel.on = false;
+    noInterrupts();
+    pwm_channel.time = time - pwm_channel_epoch_;
+    skipPwmChannelPeriods(pwm_channel_index,millis_ - pwm_channel_epoch_);
+    interrupts();
+    pwm_channel.free = false;
+  }
+  EventId pwm_channel_id;
+  pwm_channel_id.index = pwm_channel_index;
+  pwm_channel_id.time_start = time_start;
+  return pwm_channel_id;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+EventId EventController<EVENT_COUNT_MAX>::addPwmChannelUsingDelay(const Functor1<int> & functor_0,
+  const Functor1<int> & functor_1,
+  uint32_t delay,
+  uint32_t period_ms,
+  uint32_t on_duration_ms,
+  int32_t count,
+  int arg)
+{
+  uint32_t time_now = getTime();
+  uint32_t time = time_now + delay;
+  return addPwmChannelUsingTime(functor_0,
+    functor_1,
+    time,
+    period_ms,
+    on_duration_ms,
+    count,
+    arg);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::addPwmChannelStartFunctor(const EventId pwm_channel_id,
+  const Functor1<int> & functor)
+{
+  if (validPwmChannel(pwm_channel_id))
+  {
+    pwm_channel_array_[pwm_channel_id.index].functor_start = functor;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::addPwmChannelStopFunctor(const EventId pwm_channel_id,
+  const Functor1<int> & functor)
+{
+  if (validPwmChannel(pwm_channel_id))
+  {
+    pwm_channel_array_[pwm_channel_id.index].functor_stop = functor;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::enablePwmChannel(const EventId pwm_channel_id)
+{
+  if (validPwmChannel(pwm_channel_id) && !pwm_channel_array_[pwm_channel_id.index].enabled)
+  {
+    noInterrupts();
+    pwm_channel_array_[pwm_channel_id.index].enabled = true;
+    if (pwm_channel_id.index != pwm_channel_updating_)
+    {
+      skipPwmChannelPeriods(pwm_channel_id.index,millis_ - pwm_channel_epoch_);
+      insertPwmChannel(pwm_channel_id.index);
+    }
+    interrupts();
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::disablePwmChannel(const EventId pwm_channel_id)
+{
+  if (validPwmChannel(pwm_channel_id) && pwm_channel_array_[pwm_channel_id.index].enabled)
+  {
+    noInterrupts();
+    unlinkPwmChannel(pwm_channel_id.index);
+    pwm_channel_array_[pwm_channel_id.index].enabled = false;
+    interrupts();
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::removePwmChannel(const EventId pwm_channel_id)
+{
+  if (validPwmChannel(pwm_channel_id))
+  {
+    PwmChannel & pwm_channel = pwm_channel_array_[pwm_channel_id.index];
+    noInterrupts();
+    if (pwm_channel.enabled)
+    {
+      unlinkPwmChannel(pwm_channel_id.index);
+      pwm_channel.enabled = false;
+    }
+    interrupts();
+    if (pwm_channel.functor_stop)
+    {
+      pwm_channel.functor_stop(pwm_channel.arg);
+    }
+    clearPwmChannel(pwm_channel_id.index);
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::pwmChannelsActive()
+{
+  uint8_t pwm_channels_active = 0;
+  for (uint8_t pwm_channel_index=0; pwm_channel_index<pwm_channel_count_max_; ++pwm_channel_index)
+  {
+    if ((!pwm_channel_array_[pwm_channel_index].free) && pwm_channel_array_[pwm_channel_index].enabled)
+    {
+      ++pwm_channels_active;
+    }
+  }
+  return pwm_channels_active;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::pwmChannelsAvailable()
+{
+  uint8_t pwm_channels_available = 0;
+  for (uint8_t pwm_channel_index=0; pwm_channel_index<pwm_channel_count_max_; ++pwm_channel_index)
+  {
+    if (pwm_channel_array_[pwm_channel_index].free)
+    {
+      ++pwm_channels_available;
+    }
+  }
+  return pwm_channels_available;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setupInputSources(InputSource * input_source_buffer,
+  uint8_t input_source_count_max)
+{
+  noInterrupts();
+  input_source_count_max_ = 0;
+  interrupts();
+  input_source_array_ = input_source_buffer;
+  if (input_source_buffer)
+  {
+    for (uint8_t input_source_index=0; input_source_index<input_source_count_max; ++input_source_index)
+    {
+      clearInputSource(input_source_index);
+    }
+    noInterrupts();
+    input_source_count_max_ = input_source_count_max;
+    interrupts();
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+EventId EventController<EVENT_COUNT_MAX>::addInputSource(const PortInput & port_input,
+  const Functor1<int> & functor_rising,
+  const Functor1<int> & functor_falling,
+  bool debounce)
+{
+  if ((port_input.port == 0) || (port_input.mask == 0))
+  {
+    return EventId();
+  }
+  uint32_t time_start = getTime();
+  uint8_t input_source_index = 0;
+  while ((input_source_index < input_source_count_max_) && !input_source_array_[input_source_index].free)
+  {
+    ++input_source_index;
+  }
+  if (input_source_index < input_source_count_max_)
+  {
+    InputSource & input_source = input_source_array_[input_source_index];
+    input_source.functor_rising = functor_rising;
+    input_source.functor_falling = functor_falling;
+    input_source.port = port_input.port;
+    input_source.mask = port_input.mask;
+    input_source.time_start = time_start;
+    input_source.time = time_start;
+    input_source.debounce = debounce;
+    input_source.enabled = false;
+    syncInputSource(input_source);
+    input_source.free = false;
+  }
+  EventId input_source_id;
+  input_source_id.index = input_source_index;
+  input_source_id.time_start = time_start;
+  return input_source_id;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::enableInputSource(const EventId input_source_id)
+{
+  if (validInputSource(input_source_id))
+  {
+    InputSource & input_source = input_source_array_[input_source_id.index];
+    noInterrupts();
+    if (!input_source.enabled)
+    {
+      syncInputSource(input_source);
+      input_source.enabled = true;
+    }
+    interrupts();
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::disableInputSource(const EventId input_source_id)
+{
+  if (validInputSource(input_source_id))
+  {
+    input_source_array_[input_source_id.index].enabled = false;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::removeInputSource(const EventId input_source_id)
+{
+  if (validInputSource(input_source_id))
+  {
+    noInterrupts();
+    clearInputSource(input_source_id.index);
+    interrupts();
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+PortRegister EventController<EVENT_COUNT_MAX>::getInputState(const EventId input_source_id)
+{
+  PortRegister state = 0;
+  if (validInputSource(input_source_id))
+  {
+    noInterrupts();
+    state = input_source_array_[input_source_id.index].state;
+    interrupts();
+  }
+  return state;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint32_t EventController<EVENT_COUNT_MAX>::getInputTime(const EventId input_source_id)
+{
+  uint32_t time = 0;
+  if (validInputSource(input_source_id))
+  {
+    noInterrupts();
+    time = input_source_array_[input_source_id.index].time;
+    interrupts();
+  }
+  return time;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::inputSourcesActive()
+{
+  uint8_t input_sources_active = 0;
+  for (uint8_t input_source_index=0; input_source_index<input_source_count_max_; ++input_source_index)
+  {
+    if ((!input_source_array_[input_source_index].free) && input_source_array_[input_source_index].enabled)
+    {
+      ++input_sources_active;
+    }
+  }
+  return input_sources_active;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::inputSourcesAvailable()
+{
+  uint8_t input_sources_available = 0;
+  for (uint8_t input_source_index=0; input_source_index<input_source_count_max_; ++input_source_index)
+  {
+    if (input_source_array_[input_source_index].free)
+    {
+      ++input_sources_available;
+    }
+  }
+  return input_sources_available;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setEventBuffer(Event * event_buffer,
+  uint8_t event_count_max)
+{
+  if (event_buffer)
+  {
+    event_array_ = event_buffer;
+    event_count_max_ = event_count_max;
+  }
+  else
+  {
+    event_array_ = event_buffer_.data();
+    event_count_max_ = EVENT_COUNT_MAX;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::setupEventArray()
+{
+  for (uint8_t event_index=0; event_index<event_count_max_; ++event_index)
+  {
+    event_array_[event_index] = Event();
+  }
+  removeAllEvents();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::startTimer()
+{
+  noInterrupts();
+  FunctorCallbacks::Callback callback = FunctorCallbacks::add(makeFunctor((Functor0 *)0,*this,&EventController<EVENT_COUNT_MAX>::update));
+  if (event_timer_)
+  {
+    event_timer_->initialize(MICRO_SEC_PER_MILLI_SEC);
+    if (callback)
+    {
+      event_timer_->attachInterrupt(callback);
+    }
+  }
+#if defined(ARDUINO)
+  else if (timer_number_ == 1)
+  {
+    Timer1.initialize(MICRO_SEC_PER_MILLI_SEC);
+    if (callback)
+    {
+      Timer1.attachInterrupt(callback);
+    }
+  }
+  else if (timer_number_ == 3)
+  {
+    Timer3.initialize(MICRO_SEC_PER_MILLI_SEC);
+    if (callback)
+    {
+      Timer3.attachInterrupt(callback);
+    }
+  }
+#endif
+  interrupts();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint8_t EventController<EVENT_COUNT_MAX>::findAvailableEventIndex()
+{
+  uint8_t event_index = 0;
+  while ((event_index < event_count_max_) && !event_array_[event_index].free)
+  {
+    ++event_index;
+  }
+  return event_index;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint32_t EventController<EVENT_COUNT_MAX>::getBuildTime()
+{
+  if (bank_build_ != bank_active_)
+  {
+    return 0;
+  }
+  return getTime();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::rebase(uint32_t time)
+{
+  uint32_t delta = time - millis_;
+  millis_ = time;
+  for (uint8_t bank=0; bank<BANK_COUNT; ++bank)
+  {
+    if ((bank == bank_active_) || (bank != bank_build_))
+    {
+      bank_epoch_[bank] += delta;
+    }
+  }
+  bank_swap_time_ += delta;
+  pwm_channel_epoch_ += delta;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::resetBanks()
+{
+  bank_active_ = 0;
+  bank_build_ = 0;
+  bank_swap_pending_ = false;
+  bank_swap_time_ = 0;
+  for (uint8_t bank=0; bank<BANK_COUNT; ++bank)
+  {
+    bank_epoch_[bank] = 0;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::swapBanks()
+{
+  bank_epoch_[bank_build_] = millis_;
+  bank_active_ = bank_build_;
+  bank_swap_pending_ = false;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint32_t EventController<EVENT_COUNT_MAX>::nextRandom()
+{
+  uint32_t x = random_state_;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  random_state_ = x;
+  return x;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint32_t EventController<EVENT_COUNT_MAX>::drawPeriod(const Event & event)
+{
+  const EventPeriod & period = *event.period;
+  uint32_t period_ms = event.period_ms;
+  if (period.type == EVENT_PERIOD_UNIFORM)
+  {
+    uint32_t range = period.period_max_ms - period.period_min_ms + 1;
+    period_ms = period.period_min_ms;
+    if (range > 0)
+    {
+      period_ms += nextRandom() % range;
+    }
+  }
+  else if (period.type == EVENT_PERIOD_EXPONENTIAL)
+  {
+    // -ln(u) in Q16 from the position of the leading one of u and a
+    // quadratic fit of log2 over the mantissa
+    uint32_t u = nextRandom() | 1;
+    uint32_t log2_q16 = (uint32_t)31 << 16;
+    while (!(u & 0x80000000UL))
+    {
+      u <<= 1;
+      log2_q16 -= (uint32_t)1 << 16;
+    }
+    uint32_t mantissa_q16 = (u >> 15) & 0xFFFF;
+    log2_q16 += mantissa_q16 + (((mantissa_q16*(0x10000 - mantissa_q16)) >> 16)*LOG2_FIT_Q16 >> 16);
+    uint32_t neg_ln_q16 = ((((uint32_t)32 << 16) - log2_q16)*(uint64_t)LN2_Q16) >> 16;
+    period_ms = ((uint64_t)event.period_ms*neg_ln_q16 + 0x8000) >> 16;
+  }
+  if (period_ms < period.period_min_ms)
+  {
+    period_ms = period.period_min_ms;
+  }
+  else if (period_ms > period.period_max_ms)
+  {
+    period_ms = period.period_max_ms;
+  }
+  return period_ms;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+uint32_t EventController<EVENT_COUNT_MAX>::greatestCommonDivisor(uint32_t a,
+  uint32_t b)
+{
+  while (b > 0)
+  {
+    uint32_t r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+bool EventController<EVENT_COUNT_MAX>::phaseKnown(const Event & event)
+{
+  return !event.armed && !event.task && !event.period;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+bool EventController<EVENT_COUNT_MAX>::coincident(const Event & event,
+  uint32_t time,
+  uint32_t period_ms)
+{
+  if (!phaseKnown(event))
+  {
+    return true;
+  }
+  uint32_t time_diff = event.time - time;
+  if ((int32_t)time_diff < 0)
+  {
+    time_diff = -time_diff;
+  }
+  uint32_t period_gcd = greatestCommonDivisor(event.period_ms,period_ms);
+  if (period_gcd == 0)
+  {
+    return (time_diff == 0);
+  }
+  return ((time_diff % period_gcd) == 0);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+bool EventController<EVENT_COUNT_MAX>::coincident(const Event & event,
+  const Event & other)
+{
+  return !phaseKnown(other) || coincident(event,other.time,other.period_ms);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+bool EventController<EVENT_COUNT_MAX>::coincidentCostsTracked()
+{
+  // keep the gcd loop out of the tick and out of programs without a budget,
+  // the next admit rebuilds instead
+  if (coincident_cost_valid_ && ((tick_budget_us_ == 0) || updating_ || interruptContext()))
+  {
+    coincident_cost_valid_ = false;
+  }
+  return coincident_cost_valid_;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::updateCoincidentCosts()
+{
+  if (coincident_cost_valid_)
+  {
+    return;
+  }
+  coincident_cost_valid_ = true;
+  for (uint8_t event_index=0; event_index<event_count_max_; ++event_index)
+  {
+    event_array_[event_index].coincident_cost_us = 0;
+  }
+  for (uint8_t event_index=0; event_index<event_count_max_; ++event_index)
+  {
+    Event & event = event_array_[event_index];
+    if (event.free)
+    {
+      continue;
+    }
+    for (uint8_t other_index=event_index+1; other_index<event_count_max_; ++other_index)
+    {
+      Event & other = event_array_[other_index];
+      if (!other.free && (other.bank == event.bank) && coincident(event,other))
+      {
+        event.coincident_cost_us += other.cost_us;
+        other.coincident_cost_us += event.cost_us;
+      }
+    }
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::attachCoincidentCost(uint8_t event_index)
+{
+  if (!coincidentCostsTracked())
+  {
+    return;
+  }
+  Event & event = event_array_[event_index];
+  event.coincident_cost_us = 0;
+  for (uint8_t other_index=0; other_index<event_count_max_; ++other_index)
+  {
+    Event & other = event_array_[other_index];
+    if (!other.free && (other.bank == event.bank) && (other_index != event_index) &&
+      coincident(event,other))
+    {
+      event.coincident_cost_us += other.cost_us;
+      other.coincident_cost_us += event.cost_us;
+    }
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::adjustCoincidentCost(uint8_t event_index,
+  uint32_t cost_delta_us)
+{
+  if (!coincidentCostsTracked())
+  {
+    return;
+  }
+  const Event & event = event_array_[event_index];
+  for (uint8_t other_index=0; other_index<event_count_max_; ++other_index)
+  {
+    Event & other = event_array_[other_index];
+    if (!other.free && (other.bank == event.bank) && (other_index != event_index) &&
+      coincident(event,other))
+    {
+      other.coincident_cost_us += cost_delta_us;
+    }
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+bool EventController<EVENT_COUNT_MAX>::admit(uint32_t time,
+  uint32_t period_ms,
+  uint8_t bank,
+  bool phase_known,
+  uint32_t cost_us,
+  uint8_t event_index_exclude)
+{
+  if (tick_budget_us_ == 0)
+  {
+    return true;
+  }
+  updateCoincidentCosts();
+  uint32_t cost_exclude_us = 0;
+  if (event_index_exclude < event_count_max_)
+  {
+    cost_exclude_us = event_array_[event_index_exclude].cost_us;
+  }
+  uint32_t tick_cost = cost_us;
+  for (uint8_t event_index=0; event_index<event_count_max_; ++event_index)
+  {
+    const Event & event = event_array_[event_index];
+    if (!event.free && (event.bank == bank) && (event_index != event_index_exclude) &&
+      (!phase_known || coincident(event,time,period_ms)))
+    {
+      tick_cost += event.cost_us;
+      if ((event.cost_us + event.coincident_cost_us - cost_exclude_us + cost_us) > tick_budget_us_)
+      {
+        return false;
+      }
+    }
+  }
+  return (tick_cost <= tick_budget_us_);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::measureCost(Event & event,
+  uint32_t time_start_us)
+{
+  uint32_t cost_us = micros() - time_start_us;
+  if (cost_us > 0xFFFF)
+  {
+    cost_us = 0xFFFF;
+  }
+  if (cost_us > event.cost_us)
+  {
+    event.cost_us = cost_us;
+    coincident_cost_valid_ = false;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::applyPortAction(const PortAction & port_action)
 {
-  if (event_index < EVENT_COUNT_MAX)
+  switch (port_action.type)
   {
-    return event_array_[event_index];
+    case PORT_ACTION_SET:
+      *port_action.port |= port_action.mask;
+      break;
+    case PORT_ACTION_CLEAR:
+      *port_action.port &= ~port_action.mask;
+      break;
+    case PORT_ACTION_TOGGLE:
+      *port_action.port ^= port_action.mask;
+      break;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::dispatch(const Functor1<int> & functor,
+  int arg,
+  uint8_t affinity)
+{
+  if (dispatcher_)
+  {
+    dispatcher_->post(functor,arg,affinity);
   }
   else
   {
-    return Event();
+    functor(arg);
   }
 }
 
 template <uint8_t EVENT_COUNT_MAX>
-void EventController<EVENT_COUNT_MAX>::setEventArgToEventIndex(const EventId event_id)
+void EventController<EVENT_COUNT_MAX>::trace(uint8_t event_index,
+  uint8_t type,
+  uint32_t time)
 {
-  uint8_t event_index = event_id.index;
-  if (event_index < EVENT_COUNT_MAX)
+  if (trace_count_max_ == 0)
   {
-    event_array_[event_index].arg = event_index;
+    return;
+  }
+  uint8_t trace_head = trace_head_;
+  uint8_t trace_head_next = trace_head + 1;
+  if (trace_head_next == trace_count_max_)
+  {
+    trace_head_next = 0;
   }
+  if (trace_head_next == trace_tail_)
+  {
+    ++trace_overflow_count_;
+    return;
+  }
+  EventTrace & event_trace = trace_buffer_[trace_head];
+  event_trace.event_index = event_index;
+  event_trace.type = type;
+  event_trace.time = time;
+  event_trace.millis = millis_;
+  trace_head_ = trace_head_next;
 }
 
 template <uint8_t EVENT_COUNT_MAX>
-uint8_t EventController<EVENT_COUNT_MAX>::eventsActive()
+void EventController<EVENT_COUNT_MAX>::arm(const EventId event_id,
+  uint8_t trigger_group,
+  uint32_t time_now)
 {
-  uint8_t events_active = 0;
-  for (uint8_t event_index=0; event_index<event_array_.size(); ++event_index)
+  if (valid(event_id) && !event_array_[event_id.index].armed)
   {
-    if ((!event_array_[event_index].free) && event_array_[event_index].enabled)
+    Event & event = event_array_[event_id.index];
+    time_now -= bank_epoch_[event.bank];
+    if ((int32_t)(event.time - time_now) > 0)
     {
-      ++events_active;
+      event.time -= time_now;
+    }
+    else
+    {
+      event.time = 0;
     }
+    event.trigger_group = trigger_group;
+    event.enabled = true;
+    event.armed = true;
+    coincident_cost_valid_ = false;
   }
-  return events_active;
 }
 
 template <uint8_t EVENT_COUNT_MAX>
-uint8_t EventController<EVENT_COUNT_MAX>::eventsAvailable()
+void EventController<EVENT_COUNT_MAX>::triggerUsingTime(uint8_t trigger_group,
+  uint32_t time)
 {
-  uint8_t events_available = 0;
-  for (uint8_t event_index=0; event_index<event_array_.size(); ++event_index)
+  for (uint8_t event_index=0; event_index<event_count_max_; ++event_index)
   {
-    if (event_array_[event_index].free)
+    Event & event = event_array_[event_index];
+    if (event.armed && (event.trigger_group == trigger_group) && !event.free)
     {
-      ++events_available;
+      event.time += time - bank_epoch_[event.bank];
+      event.armed = false;
+      coincident_cost_valid_ = false;
     }
   }
-  return events_available;
 }
 
 template <uint8_t EVENT_COUNT_MAX>
-Array<Event,EVENT_COUNT_MAX> EventController<EVENT_COUNT_MAX>::getEventArray()
+bool EventController<EVENT_COUNT_MAX>::postCommand(uint8_t type,
+  const EventId event_id,
+  const Functor1<int> & functor)
+{
+  if (command_count_max_ == 0)
+  {
+    return false;
+  }
+  uint8_t command_head = command_head_;
+  uint8_t command_head_next = command_head + 1;
+  if (command_head_next == command_count_max_)
+  {
+    command_head_next = 0;
+  }
+  bool context = updating_ || interruptContext();
+  if (context || (command_head_next == __atomic_load_n(&command_tail_,__ATOMIC_ACQUIRE)))
+  {
+    EventCommand command;
+    command.type = type;
+    command.event_id = event_id;
+    command.functor = functor;
+    InterruptState interrupt_state = saveInterrupts();
+    if (!context)
+    {
+      processCommands();
+    }
+    applyCommand(command);
+    restoreInterrupts(interrupt_state);
+    return true;
+  }
+  EventCommand & command = command_buffer_[command_head];
+  command.type = type;
+  command.event_id = event_id;
+  command.functor = functor;
+  __atomic_store_n(&command_head_,command_head_next,__ATOMIC_RELEASE);
+  return true;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::processCommands()
 {
-  return event_array_;
+  uint8_t command_tail = command_tail_;
+  while (command_tail != __atomic_load_n(&command_head_,__ATOMIC_ACQUIRE))
+  {
+    applyCommand(command_buffer_[command_tail]);
+    if (++command_tail == command_count_max_)
+    {
+      command_tail = 0;
+    }
+  }
+  __atomic_store_n(&command_tail_,command_tail,__ATOMIC_RELEASE);
 }
 
 template <uint8_t EVENT_COUNT_MAX>
-void EventController<EVENT_COUNT_MAX>::startTimer()
+void EventController<EVENT_COUNT_MAX>::applyCommand(const EventCommand & command)
 {
-  noInterrupts();
-  if (timer_number_ == 1)
+  const EventId & event_id = command.event_id;
+  if (!valid(event_id))
   {
-    Timer1.initialize(MICRO_SEC_PER_MILLI_SEC);
+    return;
   }
-  else if (timer_number_ == 3)
+  Event & event = event_array_[event_id.index];
+  switch (command.type)
   {
-    Timer3.initialize(MICRO_SEC_PER_MILLI_SEC);
+    case EVENT_COMMAND_ENABLE:
+      event.enabled = true;
+      break;
+    case EVENT_COMMAND_DISABLE:
+      event.enabled = false;
+      break;
+    case EVENT_COMMAND_REMOVE:
+      remove(event_id.index);
+      break;
+    case EVENT_COMMAND_CLEAR:
+      clear(event_id.index);
+      break;
+    case EVENT_COMMAND_REPLACE_FUNCTOR:
+      event.functor = command.functor;
+      break;
+    case EVENT_COMMAND_ADD_START_FUNCTOR:
+      event.functor_start = command.functor;
+      break;
+    case EVENT_COMMAND_ADD_STOP_FUNCTOR:
+      event.functor_stop = command.functor;
+      break;
   }
-  FunctorCallbacks::Callback callback = FunctorCallbacks::add(makeFunctor((Functor0 *)0,*this,&EventController<EVENT_COUNT_MAX>::update));
-  if (callback)
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+bool EventController<EVENT_COUNT_MAX>::validPwmChannel(const EventId pwm_channel_id)
+{
+  uint8_t pwm_channel_index = pwm_channel_id.index;
+  return ((pwm_channel_index < pwm_channel_count_max_) &&
+    (pwm_channel_array_[pwm_channel_index].time_start == pwm_channel_id.time_start) &&
+    !pwm_channel_array_[pwm_channel_index].free);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::skipPwmChannelPeriods(uint8_t pwm_channel_index,
+  uint32_t time)
+{
+  PwmChannel & pwm_channel = pwm_channel_array_[pwm_channel_index];
+  uint32_t behind_ms = time - pwm_channel.time;
+  if ((int32_t)behind_ms > 0)
+  {
+    uint32_t period_count = (behind_ms + pwm_channel.period_ms - 1) / pwm_channel.period_ms;
+    pwm_channel.time += period_count * pwm_channel.period_ms;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::insertPwmChannel(uint8_t pwm_channel_index)
+{
+  PwmChannel & pwm_channel = pwm_channel_array_[pwm_channel_index];
+  uint8_t * next_index = &pwm_channel_head_;
+  while ((*next_index < pwm_channel_count_max_) &&
+    ((int32_t)(pwm_channel_array_[*next_index].time - pwm_channel.time) <= 0))
+  {
+    next_index = &pwm_channel_array_[*next_index].next_index;
+  }
+  pwm_channel.next_index = *next_index;
+  *next_index = pwm_channel_index;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::appendReadyPwmChannel(uint8_t pwm_channel_index)
+{
+  PwmChannel & pwm_channel = pwm_channel_array_[pwm_channel_index];
+  if (pwm_channel_ready_tail_ >= pwm_channel_count_max_)
+  {
+    pwm_channel.next_index = 255;
+    pwm_channel_ready_head_ = pwm_channel_index;
+    pwm_channel_ready_tail_ = pwm_channel_index;
+  }
+  else if ((int32_t)(pwm_channel.time - pwm_channel_array_[pwm_channel_ready_tail_].time) >= 0)
+  {
+    pwm_channel.next_index = 255;
+    pwm_channel_array_[pwm_channel_ready_tail_].next_index = pwm_channel_index;
+    pwm_channel_ready_tail_ = pwm_channel_index;
+  }
+  else
   {
-    if (timer_number_ == 1)
+    uint8_t * next_index = &pwm_channel_ready_head_;
+    while ((int32_t)(pwm_channel_array_[*next_index].time - pwm_channel.time) <= 0)
     {
-      Timer1.attachInterrupt(callback);
+      next_index = &pwm_channel_array_[*next_index].next_index;
     }
-    else if (timer_number_ == 3)
+    pwm_channel.next_index = *next_index;
+    *next_index = pwm_channel_index;
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::mergeReadyPwmChannels()
+{
+  uint8_t * next_index = &pwm_channel_head_;
+  while (pwm_channel_ready_head_ < pwm_channel_count_max_)
+  {
+    uint8_t pwm_channel_index = pwm_channel_ready_head_;
+    PwmChannel & pwm_channel = pwm_channel_array_[pwm_channel_index];
+    pwm_channel_ready_head_ = pwm_channel.next_index;
+    while ((*next_index < pwm_channel_count_max_) &&
+      ((int32_t)(pwm_channel_array_[*next_index].time - pwm_channel.time) <= 0))
     {
-      Timer3.attachInterrupt(callback);
+      next_index = &pwm_channel_array_[*next_index].next_index;
     }
+    pwm_channel.next_index = *next_index;
+    *next_index = pwm_channel_index;
+    next_index = &pwm_channel.next_index;
   }
-  interrupts();
+  pwm_channel_ready_tail_ = 255;
 }
 
 template <uint8_t EVENT_COUNT_MAX>
-uint8_t EventController<EVENT_COUNT_MAX>::findAvailableEventIndex()
+void EventController<EVENT_COUNT_MAX>::unlinkPwmChannel(uint8_t pwm_channel_index)
 {
-  uint8_t event_index = 0;
-  while ((event_index < EVENT_COUNT_MAX) && !event_array_[event_index].free)
+  uint8_t * const pwm_channel_heads[] = {&pwm_channel_head_,&pwm_channel_due_head_,&pwm_channel_ready_head_};
+  for (uint8_t list_index=0; list_index<sizeof(pwm_channel_heads)/sizeof(pwm_channel_heads[0]); ++list_index)
   {
-    ++event_index;
+    uint8_t pwm_channel_index_prev = 255;
+    uint8_t * next_index = pwm_channel_heads[list_index];
+    while (*next_index < pwm_channel_count_max_)
+    {
+      if (*next_index == pwm_channel_index)
+      {
+        *next_index = pwm_channel_array_[pwm_channel_index].next_index;
+        pwm_channel_array_[pwm_channel_index].next_index = 255;
+        if (pwm_channel_index == pwm_channel_ready_tail_)
+        {
+          pwm_channel_ready_tail_ = pwm_channel_index_prev;
+        }
+        return;
+      }
+      pwm_channel_index_prev = *next_index;
+      next_index = &pwm_channel_array_[*next_index].next_index;
+    }
+  }
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::clearPwmChannel(uint8_t pwm_channel_index)
+{
+  PwmChannel & pwm_channel = pwm_channel_array_[pwm_channel_index];
+  pwm_channel.functor_0 = functor_dummy_;
+  pwm_channel.functor_1 = functor_dummy_;
+  pwm_channel.functor_start = functor_dummy_;
+  pwm_channel.functor_stop = functor_dummy_;
+  pwm_channel.time_start = 0;
+  pwm_channel.time = 0;
+  pwm_channel.period_ms = 0;
+  pwm_channel.on_duration_ms = 0;
+  pwm_channel.count = 0;
+  pwm_channel.inc = 0;
+  pwm_channel.arg = -1;
+  pwm_channel.next_index = 255;
+  pwm_channel.enabled = false;
+  pwm_channel.infinite = false;
+  pwm_channel.on = false;
+  pwm_channel.free = true;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::updatePwmChannels()
+{
+  uint32_t time_now = millis_ - pwm_channel_epoch_;
+  uint8_t * next_index = &pwm_channel_head_;
+  while ((*next_index < pwm_channel_count_max_) &&
+    ((int32_t)(pwm_channel_array_[*next_index].time - time_now) <= 0))
+  {
+    next_index = &pwm_channel_array_[*next_index].next_index;
+  }
+  if (next_index == &pwm_channel_head_)
+  {
+    return;
+  }
+  pwm_channel_due_head_ = pwm_channel_head_;
+  pwm_channel_head_ = *next_index;
+  *next_index = 255;
+
+  while (pwm_channel_due_head_ < pwm_channel_count_max_)
+  {
+    uint8_t pwm_channel_index = pwm_channel_due_head_;
+    PwmChannel & pwm_channel = pwm_channel_array_[pwm_channel_index];
+    pwm_channel_due_head_ = pwm_channel.next_index;
+    pwm_channel.next_index = 255;
+    pwm_channel_updating_ = pwm_channel_index;
+
+    bool period_complete = true;
+    if (!pwm_channel.infinite && (pwm_channel.inc >= pwm_channel.count))
+    {
+      period_complete = false;
+    }
+    else if (!pwm_channel.on)
+    {
+      if (pwm_channel.functor_start && (pwm_channel.inc == 0))
+      {
+        pwm_channel.functor_start(pwm_channel.arg);
+      }
+      if (pwm_channel.on_duration_ms == 0)
+      {
+        if (pwm_channel.functor_1)
+        {
+          pwm_channel.functor_1(pwm_channel.arg);
+        }
+        pwm_channel.time += pwm_channel.period_ms;
+      }
+      else if (pwm_channel.on_duration_ms >= pwm_channel.period_ms)
+      {
+        if (pwm_channel.functor_0)
+        {
+          pwm_channel.functor_0(pwm_channel.arg);
+        }
+        pwm_channel.time += pwm_channel.period_ms;
+      }
+      else
+      {
+        if (pwm_channel.functor_0)
+        {
+          pwm_channel.functor_0(pwm_channel.arg);
+        }
+        pwm_channel.time += pwm_channel.on_duration_ms;
+        pwm_channel.on = true;
+        period_complete = false;
+      }
+    }
+    else
+    {
+      if (pwm_channel.functor_1)
+      {
+        pwm_channel.functor_1(pwm_channel.arg);
+      }
+      pwm_channel.time += pwm_channel.period_ms - pwm_channel.on_duration_ms;
+      pwm_channel.on = false;
+    }
+    if (period_complete)
+    {
+      ++pwm_channel.inc;
+    }
+    pwm_channel_updating_ = 255;
+    if (!pwm_channel.enabled)
+    {
+      continue;
+    }
+    if (pwm_channel.infinite || (pwm_channel.inc < pwm_channel.count) || pwm_channel.on)
+    {
+      skipPwmChannelPeriods(pwm_channel_index,time_now + 1);
+      appendReadyPwmChannel(pwm_channel_index);
+    }
+    else
+    {
+      if (pwm_channel.functor_stop)
+      {
+        pwm_channel.functor_stop(pwm_channel.arg);
+      }
+      clearPwmChannel(pwm_channel_index);
+    }
+  }
+  mergeReadyPwmChannels();
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+bool EventController<EVENT_COUNT_MAX>::validInputSource(const EventId input_source_id)
+{
+  uint8_t input_source_index = input_source_id.index;
+  return ((input_source_index < input_source_count_max_) &&
+    (input_source_array_[input_source_index].time_start == input_source_id.time_start) &&
+    !input_source_array_[input_source_index].free);
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::syncInputSource(InputSource & input_source)
+{
+  input_source.state = *input_source.port & input_source.mask;
+  input_source.count_0 = 0;
+  input_source.count_1 = 0;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::clearInputSource(uint8_t input_source_index)
+{
+  InputSource & input_source = input_source_array_[input_source_index];
+  input_source.functor_rising = functor_dummy_;
+  input_source.functor_falling = functor_dummy_;
+  input_source.port = 0;
+  input_source.mask = 0;
+  input_source.state = 0;
+  input_source.count_0 = 0;
+  input_source.count_1 = 0;
+  input_source.time_start = 0;
+  input_source.time = 0;
+  input_source.debounce = false;
+  input_source.enabled = false;
+  input_source.free = true;
+}
+
+template <uint8_t EVENT_COUNT_MAX>
+void EventController<EVENT_COUNT_MAX>::updateInputSources()
+{
+  for (uint8_t input_source_index=0; input_source_index<input_source_count_max_; ++input_source_index)
+  {
+    InputSource & input_source = input_source_array_[input_source_index];
+    if (input_source.free || !input_source.enabled)
+    {
+      continue;
+    }
+    PortRegister delta = (*input_source.port & input_source.mask) ^ input_source.state;
+    PortRegister toggle = delta;
+    if (input_source.debounce)
+    {
+      // two bit vertical counter per pin, toggling after four differing samples
+      input_source.count_1 = (input_source.count_1 ^ input_source.count_0) & delta;
+      input_source.count_0 = ~input_source.count_0 & delta;
+      toggle = delta & ~(input_source.count_0 | input_source.count_1);
+    }
+    if (toggle == 0)
+    {
+      continue;
+    }
+    input_source.state ^= toggle;
+    input_source.time = millis_;
+    PortRegister rising = toggle & input_source.state;
+    PortRegister falling = toggle & ~input_source.state;
+    if (rising && input_source.functor_rising)
+    {
+      dispatch(input_source.functor_rising,rising,EventDispatcher::AFFINITY_ANY);
+    }
+    if (falling && input_source.functor_falling)
+    {
+      dispatch(input_source.functor_falling,falling,EventDispatcher::AFFINITY_ANY);
+    }
   }
-  return event_index;
 }
 
 template <uint8_t EVENT_COUNT_MAX>
 void EventController<EVENT_COUNT_MAX>::update()
 {
   noInterrupts();
+  updating_ = true;
   ++millis_;
+  if (bank_swap_pending_ && ((int32_t)(millis_ - bank_swap_time_) >= 0))
+  {
+    swapBanks();
+  }
   interrupts();
 
-  for (uint8_t event_index = 0; event_index < EVENT_COUNT_MAX; ++event_index)
+  updateInputSources();
+  processCommands();
+  updatePwmChannels();
+
+  for (uint8_t event_index = 0; event_index < event_count_max_; ++event_index)
   {
     Event& event = event_array_[event_index];
-    if ((!event.free) && (event.time <= millis_))
+    uint32_t bank_epoch = bank_epoch_[event.bank];
+    uint32_t time_now = millis_ - bank_epoch;
+    if ((!__atomic_load_n(&event.free,__ATOMIC_ACQUIRE)) && (!event.armed) && (event.bank == bank_active_) && ((int32_t)(event.time - time_now) <= 0))
     {
       if ((event.enabled) && ((event.infinite) || (event.inc < event.count)))
       {
-        while ((event.period_ms > 0) &&
-          (event.time <= millis_))
+        uint32_t time = event.time;
+        if (event.period)
+        {
+          while ((int32_t)(event.time - time_now) <= 0)
+          {
+            event.time += drawPeriod(event);
+          }
+        }
+        else
+        {
+          while ((event.period_ms > 0) &&
+            ((int32_t)(event.time - time_now) <= 0))
+          {
+            event.time += event.period_ms;
+          }
+        }
+        int arg = event.arg;
+        if (event.ramp)
         {
-          event.time += event.period_ms;
+          arg = event.ramp->value;
+          advanceRamp(*event.ramp);
         }
+        uint32_t time_start_us = cost_measurement_enabled_ ? micros() : 0;
         if (event.functor_start && (event.inc == 0))
         {
+          trace(event_index,EVENT_TRACE_START,time + bank_epoch);
           event.functor_start(event.arg);
         }
-        if (event.functor)
+        trace(event_index,EVENT_TRACE_MAIN,time + bank_epoch);
+        if (event.task)
+        {
+          int32_t task_delay = event.task->functor(*event.task);
+          ++event.task->step;
+          if (task_delay < 0)
+          {
+            event.infinite = false;
+            event.count = event.inc + 1;
+          }
+          else
+          {
+            event.time = time_now + task_delay;
+          }
+        }
+        else if (event.port_action.type != PORT_ACTION_NONE)
+        {
+          applyPortAction(event.port_action);
+        }
+        else if (event.functor)
+        {
+          dispatch(event.functor,arg,event.affinity);
+        }
+        uint8_t group_index = event.group_index;
+        while (group_index < group_functor_count_max_)
+        {
+          const GroupFunctor & group_functor = group_functor_array_[group_index];
+          if (group_functor.enabled)
+          {
+            if (group_functor.port_action.type != PORT_ACTION_NONE)
+            {
+              applyPortAction(group_functor.port_action);
+            }
+            else
+            {
+              dispatch(group_functor.functor,group_functor.arg,event.affinity);
+            }
+          }
+          group_index = group_functor.next_index;
+        }
+        if (cost_measurement_enabled_)
         {
-          event.functor(event.arg);
+          measureCost(event,time_start_us);
         }
         ++event.inc;
       }
       else
       {
+        if (event.functor_stop)
+        {
+          trace(event_index,EVENT_TRACE_STOP,event.time + bank_epoch);
+        }
         remove(event_index);
       }
     }
   }
+
+  if (dispatcher_)
+  {
+    dispatcher_->wait();
+  }
+  updating_ = false;
 }
 
 #endif
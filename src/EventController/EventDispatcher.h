@@ -0,0 +1,28 @@
+// ----------------------------------------------------------------------------
+// EventDispatcher.h
+//
+//
+// Authors:
+// Peter Polidoro peterpolidoro@gmail.com
+// ----------------------------------------------------------------------------
+#ifndef EVENT_DISPATCHER_H
+#define EVENT_DISPATCHER_H
+#include <Functor.h>
+
+
+class EventDispatcher
+{
+public:
+  virtual ~EventDispatcher() {}
+  enum{AFFINITY_ANY=255};
+  virtual void post(const Functor1<int> & functor,
+    int arg,
+    uint8_t affinity) = 0;
+  // post and wait are called from the timer callback with interrupts
+  // disabled. wait may call interrupts() while it blocks on the workers,
+  // but must call noInterrupts() again before returning, so a timer backend
+  // running update on another thread must hold the lock around the callback.
+  virtual void wait() = 0;
+};
+
+#endif
@@ -0,0 +1,165 @@
+// ----------------------------------------------------------------------------
+// EventDispatcherThreads.h
+//
+//
+// Authors:
+// Peter Polidoro peterpolidoro@gmail.com
+// ----------------------------------------------------------------------------
+#ifndef EVENT_DISPATCHER_THREADS_H
+#define EVENT_DISPATCHER_THREADS_H
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "../EventController.h"
+
+
+class EventDispatcherThreads : public EventDispatcher
+{
+public:
+  EventDispatcherThreads(uint8_t worker_count=2);
+  ~EventDispatcherThreads();
+  void post(const Functor1<int> & functor,
+    int arg,
+    uint8_t affinity);
+  void wait();
+  uint8_t getWorkerCount();
+private:
+  struct Job
+  {
+    Functor1<int> functor;
+    int arg;
+  };
+  std::vector<std::thread> workers_;
+  std::vector<std::vector<Job> > jobs_;
+  std::mutex mutex_;
+  std::condition_variable start_condition_;
+  std::condition_variable done_condition_;
+  uint32_t generation_;
+  uint8_t workers_pending_;
+  uint8_t worker_next_;
+  bool jobs_posted_;
+  bool stopping_;
+
+  void run(uint8_t worker_index);
+};
+
+inline EventDispatcherThreads::EventDispatcherThreads(uint8_t worker_count)
+{
+  if (worker_count == 0)
+  {
+    worker_count = 1;
+  }
+  generation_ = 0;
+  workers_pending_ = 0;
+  worker_next_ = 0;
+  jobs_posted_ = false;
+  stopping_ = false;
+  jobs_.resize(worker_count);
+  for (uint8_t worker_index=0; worker_index<worker_count; ++worker_index)
+  {
+    workers_.push_back(std::thread(&EventDispatcherThreads::run,this,worker_index));
+  }
+}
+
+inline EventDispatcherThreads::~EventDispatcherThreads()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  start_condition_.notify_all();
+  for (size_t worker_index=0; worker_index<workers_.size(); ++worker_index)
+  {
+    workers_[worker_index].join();
+  }
+}
+
+inline void EventDispatcherThreads::post(const Functor1<int> & functor,
+  int arg,
+  uint8_t affinity)
+{
+  uint8_t worker_count = jobs_.size();
+  uint8_t worker_index;
+  if (affinity == AFFINITY_ANY)
+  {
+    worker_index = worker_next_;
+    if (++worker_next_ == worker_count)
+    {
+      worker_next_ = 0;
+    }
+  }
+  else
+  {
+    worker_index = affinity % worker_count;
+  }
+  Job job;
+  job.functor = functor;
+  job.arg = arg;
+  jobs_[worker_index].push_back(job);
+  jobs_posted_ = true;
+}
+
+inline void EventDispatcherThreads::wait()
+{
+  if (!jobs_posted_)
+  {
+    return;
+  }
+  interrupts();
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++generation_;
+    workers_pending_ = jobs_.size();
+    start_condition_.notify_all();
+    while (workers_pending_ > 0)
+    {
+      done_condition_.wait(lock);
+    }
+  }
+  noInterrupts();
+  jobs_posted_ = false;
+  worker_next_ = 0;
+}
+
+inline uint8_t EventDispatcherThreads::getWorkerCount()
+{
+  return jobs_.size();
+}
+
+inline void EventDispatcherThreads::run(uint8_t worker_index)
+{
+  uint32_t generation = 0;
+  std::vector<Job> & jobs = jobs_[worker_index];
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!stopping_ && (generation == generation_))
+      {
+        start_condition_.wait(lock);
+      }
+      if (stopping_)
+      {
+        return;
+      }
+      generation = generation_;
+    }
+    for (size_t job_index=0; job_index<jobs.size(); ++job_index)
+    {
+      jobs[job_index].functor(jobs[job_index].arg);
+    }
+    jobs.clear();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--workers_pending_ == 0)
+      {
+        done_condition_.notify_one();
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,21 @@
+// ----------------------------------------------------------------------------
+// EventTimer.h
+//
+//
+// Authors:
+// Peter Polidoro peterpolidoro@gmail.com
+// ----------------------------------------------------------------------------
+#ifndef EVENT_TIMER_H
+#define EVENT_TIMER_H
+#include <stdint.h>
+
+
+class EventTimer
+{
+public:
+  virtual ~EventTimer() {}
+  virtual void initialize(uint32_t period_us) = 0;
+  virtual void attachInterrupt(void (*callback)()) = 0;
+};
+
+#endif
@@ -0,0 +1,236 @@
+// ----------------------------------------------------------------------------
+// EventTimerLinux.h
+//
+//
+// Authors:
+// Peter Polidoro peterpolidoro@gmail.com
+// ----------------------------------------------------------------------------
+#ifndef EVENT_TIMER_LINUX_H
+#define EVENT_TIMER_LINUX_H
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "EventTimer.h"
+
+
+inline pthread_mutex_t & eventTimerLinuxMutex()
+{
+  static pthread_mutex_t mutex;
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  struct Initializer
+  {
+    static void initialize()
+    {
+      pthread_mutexattr_t mutex_attr;
+      pthread_mutexattr_init(&mutex_attr);
+      pthread_mutexattr_settype(&mutex_attr,PTHREAD_MUTEX_RECURSIVE);
+      pthread_mutex_init(&mutex,&mutex_attr);
+      pthread_mutexattr_destroy(&mutex_attr);
+    }
+  };
+  pthread_once(&once,Initializer::initialize);
+  return mutex;
+}
+
+inline void noInterrupts()
+{
+  pthread_mutex_lock(&eventTimerLinuxMutex());
+}
+
+inline void interrupts()
+{
+  pthread_mutex_unlock(&eventTimerLinuxMutex());
+}
+
+inline uint32_t micros()
+{
+  timespec time;
+  clock_gettime(CLOCK_MONOTONIC,&time);
+  return (uint32_t)(time.tv_sec*1000000UL + time.tv_nsec/1000);
+}
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t byte) = 0;
+  virtual size_t write(const uint8_t * buffer,
+    size_t size)
+  {
+    size_t bytes_written = 0;
+    while (size--)
+    {
+      bytes_written += write(*buffer++);
+    }
+    return bytes_written;
+  }
+};
+
+struct EventTimerJitter
+{
+  uint32_t tick_count;
+  uint32_t overrun_count;
+  int64_t latency_min_ns;
+  int64_t latency_max_ns;
+  int64_t latency_sum_ns;
+};
+
+class EventTimerLinux : public EventTimer
+{
+public:
+  EventTimerLinux(int priority=PRIORITY_DEFAULT);
+  ~EventTimerLinux();
+  enum{PRIORITY_DEFAULT=80};
+  enum{NANO_SEC_PER_SEC=1000000000};
+  enum{NANO_SEC_PER_MICRO_SEC=1000};
+  void initialize(uint32_t period_us);
+  void attachInterrupt(void (*callback)());
+  void stop();
+  bool realtime();
+  EventTimerJitter getJitter();
+  void resetJitter();
+private:
+  int priority_;
+  uint32_t period_ns_;
+  void (*callback_)();
+  pthread_t thread_;
+  volatile bool running_;
+  bool realtime_;
+  EventTimerJitter jitter_;
+
+  void start();
+  void run();
+  static void * runThread(void * event_timer);
+};
+
+inline EventTimerLinux::EventTimerLinux(int priority)
+{
+  priority_ = priority;
+  period_ns_ = 0;
+  callback_ = NULL;
+  running_ = false;
+  realtime_ = false;
+  resetJitter();
+}
+
+inline EventTimerLinux::~EventTimerLinux()
+{
+  stop();
+}
+
+inline void EventTimerLinux::initialize(uint32_t period_us)
+{
+  period_ns_ = period_us * NANO_SEC_PER_MICRO_SEC;
+}
+
+inline void EventTimerLinux::attachInterrupt(void (*callback)())
+{
+  callback_ = callback;
+  start();
+}
+
+inline void EventTimerLinux::stop()
+{
+  if (running_)
+  {
+    running_ = false;
+    pthread_join(thread_,NULL);
+  }
+}
+
+inline bool EventTimerLinux::realtime()
+{
+  return realtime_;
+}
+
+inline EventTimerJitter EventTimerLinux::getJitter()
+{
+  noInterrupts();
+  EventTimerJitter jitter = jitter_;
+  interrupts();
+  return jitter;
+}
+
+inline void EventTimerLinux::resetJitter()
+{
+  noInterrupts();
+  jitter_.tick_count = 0;
+  jitter_.overrun_count = 0;
+  jitter_.latency_min_ns = INT64_MAX;
+  jitter_.latency_max_ns = 0;
+  jitter_.latency_sum_ns = 0;
+  interrupts();
+}
+
+inline void EventTimerLinux::start()
+{
+  if (running_ || (period_ns_ == 0) || (callback_ == NULL))
+  {
+    return;
+  }
+  running_ = true;
+
+  pthread_attr_t thread_attr;
+  pthread_attr_init(&thread_attr);
+  pthread_attr_setinheritsched(&thread_attr,PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&thread_attr,SCHED_FIFO);
+  sched_param param;
+  param.sched_priority = priority_;
+  pthread_attr_setschedparam(&thread_attr,&param);
+  realtime_ = (pthread_create(&thread_,&thread_attr,runThread,this) == 0);
+  pthread_attr_destroy(&thread_attr);
+  if (!realtime_ && (pthread_create(&thread_,NULL,runThread,this) != 0))
+  {
+    running_ = false;
+  }
+}
+
+inline void EventTimerLinux::run()
+{
+  timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC,&deadline);
+  while (running_)
+  {
+    deadline.tv_nsec += period_ns_;
+    while (deadline.tv_nsec >= NANO_SEC_PER_SEC)
+    {
+      deadline.tv_nsec -= NANO_SEC_PER_SEC;
+      ++deadline.tv_sec;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&deadline,NULL);
+
+    timespec time_now;
+    clock_gettime(CLOCK_MONOTONIC,&time_now);
+    int64_t latency_ns = (int64_t)(time_now.tv_sec - deadline.tv_sec)*NANO_SEC_PER_SEC +
+      (time_now.tv_nsec - deadline.tv_nsec);
+
+    noInterrupts();
+    ++jitter_.tick_count;
+    if (latency_ns > (int64_t)period_ns_)
+    {
+      ++jitter_.overrun_count;
+    }
+    if (latency_ns < jitter_.latency_min_ns)
+    {
+      jitter_.latency_min_ns = latency_ns;
+    }
+    if (latency_ns > jitter_.latency_max_ns)
+    {
+      jitter_.latency_max_ns = latency_ns;
+    }
+    jitter_.latency_sum_ns += latency_ns;
+    callback_();
+    interrupts();
+  }
+}
+
+inline void * EventTimerLinux::runThread(void * event_timer)
+{
+  static_cast<EventTimerLinux *>(event_timer)->run();
+  return NULL;
+}
+
+#endif
@@ -0,0 +1,55 @@
+// ----------------------------------------------------------------------------
+// EventTimerManual.h
+//
+//
+// Authors:
+// Peter Polidoro peterpolidoro@gmail.com
+// ----------------------------------------------------------------------------
+#ifndef EVENT_TIMER_MANUAL_H
+#define EVENT_TIMER_MANUAL_H
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../EventController.h"
+
+
+class EventTimerManual : public EventTimer
+{
+public:
+  EventTimerManual();
+  void initialize(uint32_t period_us);
+  void attachInterrupt(void (*callback)());
+  void tick(uint32_t tick_count=1);
+private:
+  void (*callback_)();
+};
+
+inline EventTimerManual::EventTimerManual()
+{
+  callback_ = NULL;
+}
+
+inline void EventTimerManual::initialize(uint32_t period_us)
+{
+}
+
+inline void EventTimerManual::attachInterrupt(void (*callback)())
+{
+  callback_ = callback;
+}
+
+inline void EventTimerManual::tick(uint32_t tick_count)
+{
+  if (callback_ == NULL)
+  {
+    return;
+  }
+  while (tick_count--)
+  {
+    noInterrupts();
+    callback_();
+    interrupts();
+  }
+}
+
+#endif